@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+#
+# Measures the ALSA sequencer writes of the pass-through with and without batching.
+#
+# Starts a receivemidi with a virtual input port as destination, and a receivemidi that passes
+# the messages of an RTP-MIDI session through to that port. A scripted peer sends packets of
+# several notes each. Every mode is run twice: once under strace to count the system calls that
+# write to the sequencer, and once on its own to time how long it takes until the destination
+# has received all the messages and how much CPU time the pass-through used.
+#
+# Needs Linux with the snd-seq module loaded, strace, and a receivemidi that was built with ALSA.
+#
+# usage: measure-alsa-batching.py [path to receivemidi] [packets] [notes per packet]
+
+import os
+import re
+import shutil
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+RECEIVEMIDI = sys.argv[1] if len(sys.argv) > 1 else "Builds/LinuxMakefile/build/receivemidi"
+PACKETS = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+NOTES = int(sys.argv[3]) if len(sys.argv) > 3 else 16
+PORT = 5204
+HOST = "127.0.0.1"
+SSRC = 0x55667788
+TOKEN = 99
+DESTINATION = "batching-measure"
+
+
+def invite(sock, port):
+    sock.settimeout(0.2)
+    for _ in range(25):
+        sock.sendto(b"\xff\xffIN" + struct.pack(">III", 2, TOKEN, SSRC) + b"peer\0", (HOST, port))
+        try:
+            reply = sock.recv(100)
+            if reply[2:4] == b"OK":
+                return True
+        except socket.timeout:
+            pass
+    return False
+
+
+def commands(packet):
+    # note-ons and note-offs alternate between packets, each command has a zero delta time
+    data = bytearray()
+    for note in range(NOTES):
+        if note > 0:
+            data.append(0)
+        data += bytes([0x90, 36 + note, 100 if packet % 2 == 0 else 0])
+    return bytes(data)
+
+
+def count_lines(process, total, done):
+    received = 0
+    for _ in process.stdout:
+        received += 1
+        if received == total:
+            done.set()
+
+
+def run(batched, traced):
+    total = PACKETS * NOTES
+    environment = dict(os.environ)
+    environment.pop("RECEIVEMIDI_NO_ALSA_BATCHING", None)
+    if not batched:
+        environment["RECEIVEMIDI_NO_ALSA_BATCHING"] = "1"
+
+    destination = subprocess.Popen([RECEIVEMIDI, "virt", DESTINATION], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+    done = threading.Event()
+    counter = threading.Thread(target=count_lines, args=(destination, total, done), daemon=True)
+    counter.start()
+    time.sleep(0.5)
+
+    trace = tempfile.NamedTemporaryFile(suffix=".strace", delete=False)
+    trace.close()
+    command = [RECEIVEMIDI, "rtp", str(PORT), "pass", DESTINATION, "q"]
+    if traced:
+        command = ["strace", "-f", "-c", "-e", "trace=write,writev,ioctl", "-o", trace.name] + command
+    passthrough = subprocess.Popen(command, env=environment, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+    control = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    control.bind((HOST, 0))
+    data = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    data.bind((HOST, 0))
+    result = None
+    try:
+        if not invite(control, PORT) or not invite(data, PORT + 1):
+            print("FAILED: receivemidi didn't accept the invitation")
+        else:
+            start = time.monotonic()
+            for packet in range(PACKETS):
+                header = struct.pack(">BBHII", 0x80, 0x61, (packet + 1) & 0xffff, 0, SSRC)
+                payload = commands(packet)
+                data.sendto(header + bytes([len(payload)]) + payload, (HOST, PORT + 1))
+                # a short pause every few packets keeps the socket buffers from overflowing
+                if packet % 50 == 49:
+                    time.sleep(0.001)
+            received = done.wait(30)
+            elapsed = time.monotonic() - start
+
+            control.sendto(b"\xff\xffBY" + struct.pack(">III", 2, TOKEN, SSRC), (HOST, PORT))
+            result = {"received": received, "elapsed": elapsed, "total": total}
+    finally:
+        passthrough.send_signal(signal.SIGINT)
+        _, _, usage = os.wait4(passthrough.pid, 0)
+        destination.send_signal(signal.SIGINT)
+        destination.wait(5)
+
+    if result is not None:
+        result["cpu"] = usage.ru_utime + usage.ru_stime
+        if traced:
+            calls = {}
+            with open(trace.name) as summary:
+                for line in summary:
+                    fields = line.split()
+                    if len(fields) >= 5 and fields[-1] in ("write", "writev", "ioctl") and re.match(r"^\d", fields[3]):
+                        calls[fields[-1]] = int(fields[3])
+            result["calls"] = calls
+    os.unlink(trace.name)
+    return result
+
+
+def main():
+    if shutil.which("strace") is None:
+        print("FAILED: strace is needed to count the system calls")
+        return 1
+
+    print("%d packets of %d notes, %d messages" % (PACKETS, NOTES, PACKETS * NOTES))
+    for batched in (False, True):
+        traced = run(batched, True)
+        timed = run(batched, False)
+        if traced is None or timed is None:
+            return 1
+        name = "batched" if batched else "unbatched"
+        if not timed["received"]:
+            print("%-10s the destination didn't receive all the messages" % name)
+            continue
+        calls = traced["calls"]
+        print("%-10s write %7d  writev %7d  ioctl %7d  %8.0f messages/s  %.3f s CPU" %
+              (name, calls.get("write", 0), calls.get("writev", 0), calls.get("ioctl", 0),
+               timed["total"] / timed["elapsed"], timed["cpu"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+#
+# Loopback test of the RTP-MIDI input with a scripted AppleMIDI peer.
+#
+# Starts receivemidi with the "rtp" command, joins the session, sends packets with a gap,
+# a duplicate and a late packet, and checks the messages that receivemidi prints, including
+# the ones that are recovered from the journal.
+#
+# usage: test-rtp-midi.py [path to receivemidi] [control port]
+
+import signal
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+RECEIVEMIDI = sys.argv[1] if len(sys.argv) > 1 else "Builds/LinuxMakefile/build/receivemidi"
+PORT = int(sys.argv[2]) if len(sys.argv) > 2 else 5104
+HOST = "127.0.0.1"
+SSRC = 0x11223344
+TOKEN = 77
+
+EXPECTED = [
+    # regular packets
+    "channel  1   note-on           C3 100",
+    "channel  2   control-change     7    50",
+    # the packet after the gap recovers CC 1, the pitch bend and E3, CC 7 and C3 are unchanged
+    "channel  2   control-change     1    10",
+    "channel  1   pitch-bend          4096",
+    "channel  1   note-on           E3  80",
+    # the commands of the packet after the gap itself
+    "channel  1   note-off          C3   0",
+]
+
+
+def invite(sock, port):
+    sock.settimeout(0.2)
+    for _ in range(25):
+        sock.sendto(b"\xff\xffIN" + struct.pack(">III", 2, TOKEN, SSRC) + b"peer\0", (HOST, port))
+        try:
+            reply = sock.recv(100)
+            if reply[2:4] == b"OK":
+                return True
+        except socket.timeout:
+            pass
+    return False
+
+
+def rtp(sock, sequence, commands, journal=b""):
+    flags = 0x40 if journal else 0
+    header = struct.pack(">BBHII", 0x80, 0x61, sequence, 0, SSRC)
+    sock.sendto(header + bytes([flags | len(commands)]) + commands + journal, (HOST, PORT + 1))
+
+
+def channel_journal(channel, chapters, data):
+    length = 3 + len(data)
+    return bytes([(channel << 3) | (length >> 8), length & 0xff, chapters]) + data
+
+
+def main():
+    receiver = subprocess.Popen([RECEIVEMIDI, "rtp", str(PORT)], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+    control = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    control.bind((HOST, 0))
+    data = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    data.bind((HOST, 0))
+
+    try:
+        if not invite(control, PORT) or not invite(data, PORT + 1):
+            print("FAILED: receivemidi didn't accept the invitation")
+            return 1
+
+        data.sendto(b"\xff\xffCK" + struct.pack(">IB3xQQQ", SSRC, 0, 1234, 0, 0), (HOST, PORT + 1))
+        data.recv(100)
+
+        rtp(data, 1, bytes([0x90, 60, 100, 0xb1, 7, 50]))
+        # a duplicate is dropped
+        rtp(data, 1, bytes([0x90, 60, 100, 0xb1, 7, 50]))
+
+        # packets 2 and 3 are lost, the journal of packet 4 has the state of the sender
+        chapter_c = bytes([0x01, 7, 50, 1, 10])
+        chapter_w = bytes([0x00, 0x20])
+        chapter_n = bytes([0x02, 0x00, 60, 0x80 | 100, 64, 0x80 | 80])
+        journal = bytes([0x20 | 0x01, 0, 4])
+        journal += channel_journal(1, 0x40, chapter_c)
+        journal += channel_journal(0, 0x10 | 0x08, chapter_w + chapter_n)
+        rtp(data, 4, bytes([0x80, 60, 0]), journal)
+
+        # the late packet 3 is dropped, its commands are covered by the journal
+        rtp(data, 3, bytes([0x90, 62, 90]))
+
+        time.sleep(0.3)
+        control.sendto(b"\xff\xffBY" + struct.pack(">III", 2, TOKEN, SSRC), (HOST, PORT))
+        time.sleep(0.2)
+    finally:
+        receiver.send_signal(signal.SIGINT)
+        output = receiver.communicate(timeout=5)[0]
+
+    lines = [line.rstrip() for line in output.splitlines()]
+    if lines != EXPECTED:
+        print("FAILED: unexpected messages")
+        print("expected:\n  " + "\n  ".join(EXPECTED))
+        print("received:\n  " + "\n  ".join(lines))
+        return 1
+
+    print("OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
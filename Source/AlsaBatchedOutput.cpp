@@ -0,0 +1,192 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AlsaBatchedOutput.h"
+
+#if JUCE_ALSA
+
+#include <alsa/asoundlib.h>
+
+namespace
+{
+    constexpr size_t DEFAULT_PARSER_SIZE = 256;
+    
+    // finds a writable port with the same name, or else one whose name contains it, just like
+    // the pass-through port is found
+    bool findDestination(snd_seq_t* seq, const String& name, int& destinationClient, int& destinationPort)
+    {
+        snd_seq_client_info_t* clientInfo;
+        snd_seq_port_info_t* portInfo;
+        snd_seq_client_info_alloca(&clientInfo);
+        snd_seq_port_info_alloca(&portInfo);
+        
+        const unsigned int capabilities = SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE;
+        const int ownClient = snd_seq_client_id(seq);
+        
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            snd_seq_client_info_set_client(clientInfo, -1);
+            while (snd_seq_query_next_client(seq, clientInfo) >= 0)
+            {
+                const int client = snd_seq_client_info_get_client(clientInfo);
+                if (client == ownClient)
+                {
+                    continue;
+                }
+                
+                snd_seq_port_info_set_client(portInfo, client);
+                snd_seq_port_info_set_port(portInfo, -1);
+                while (snd_seq_query_next_port(seq, portInfo) >= 0)
+                {
+                    if ((snd_seq_port_info_get_capability(portInfo) & capabilities) != capabilities)
+                    {
+                        continue;
+                    }
+                    
+                    const String portName(snd_seq_port_info_get_name(portInfo));
+                    if ((pass == 0 && portName == name) || (pass == 1 && portName.containsIgnoreCase(name)))
+                    {
+                        destinationClient = client;
+                        destinationPort = snd_seq_port_info_get_port(portInfo);
+                        return true;
+                    }
+                }
+            }
+        }
+        
+        return false;
+    }
+}
+
+std::unique_ptr<AlsaBatchedOutput> AlsaBatchedOutput::open(const String& name)
+{
+    // allows comparing against JUCE's unbatched output with the same build
+    if (SystemStats::getEnvironmentVariable("RECEIVEMIDI_NO_ALSA_BATCHING", {}).isNotEmpty())
+    {
+        return nullptr;
+    }
+    
+    snd_seq_t* seq = nullptr;
+    if (snd_seq_open(&seq, "default", SND_SEQ_OPEN_OUTPUT, 0) < 0)
+    {
+        return nullptr;
+    }
+    snd_seq_set_client_name(seq, ProjectInfo::projectName);
+    
+    int destinationClient = -1;
+    int destinationPort = -1;
+    snd_midi_event_t* parser = nullptr;
+    const int port = snd_seq_create_simple_port(seq, name.toRawUTF8(),
+                                                SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ,
+                                                SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    if (port < 0 ||
+        !findDestination(seq, name, destinationClient, destinationPort) ||
+        snd_seq_connect_to(seq, port, destinationClient, destinationPort) < 0 ||
+        snd_seq_set_output_buffer_size(seq, OUTPUT_BUFFER_SIZE) < 0 ||
+        snd_midi_event_new(DEFAULT_PARSER_SIZE, &parser) < 0)
+    {
+        snd_seq_close(seq);
+        return nullptr;
+    }
+    
+    return std::unique_ptr<AlsaBatchedOutput>(new AlsaBatchedOutput(seq, port, parser));
+}
+
+AlsaBatchedOutput::AlsaBatchedOutput(snd_seq_t* seq, int port, snd_midi_event_t* parser) :
+    seq_(seq), port_(port), parser_(parser), parserSize_(DEFAULT_PARSER_SIZE)
+{
+}
+
+AlsaBatchedOutput::~AlsaBatchedOutput()
+{
+    drain();
+    snd_midi_event_free(parser_);
+    snd_seq_delete_simple_port(seq_, port_);
+    snd_seq_close(seq_);
+}
+
+int64 AlsaBatchedOutput::getNumMessages() const
+{
+    return messages_;
+}
+
+int64 AlsaBatchedOutput::getNumDrains() const
+{
+    return drains_;
+}
+
+void AlsaBatchedOutput::enqueue(const MidiMessage& msg)
+{
+    const uint8* data = msg.getRawData();
+    long remaining = msg.getRawDataSize();
+    if ((size_t)remaining > parserSize_)
+    {
+        parserSize_ = (size_t)remaining;
+        snd_midi_event_resize_buffer(parser_, parserSize_);
+    }
+    
+    snd_seq_event_t event;
+    snd_seq_ev_clear(&event);
+    while (remaining > 0)
+    {
+        const long consumed = snd_midi_event_encode(parser_, data, remaining, &event);
+        if (consumed <= 0)
+        {
+            break;
+        }
+        remaining -= consumed;
+        data += consumed;
+        
+        if (event.type == SND_SEQ_EVENT_NONE)
+        {
+            continue;
+        }
+        
+        snd_seq_ev_set_source(&event, (unsigned char)port_);
+        snd_seq_ev_set_subs(&event);
+        snd_seq_ev_set_direct(&event);
+        
+        // the event and its SysEx data are copied into the output buffer, which is only
+        // written out early when it's full
+        if (snd_seq_event_output_buffer(seq_, &event) < 0)
+        {
+            drain();
+            snd_seq_event_output_buffer(seq_, &event);
+        }
+        pending_ = true;
+        
+        snd_seq_ev_clear(&event);
+    }
+    snd_midi_event_reset_encode(parser_);
+    
+    messages_ += 1;
+}
+
+void AlsaBatchedOutput::drain()
+{
+    if (!pending_)
+    {
+        return;
+    }
+    
+    snd_seq_drain_output(seq_);
+    drains_ += 1;
+    pending_ = false;
+}
+
+#endif
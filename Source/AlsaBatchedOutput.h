@@ -0,0 +1,65 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#if JUCE_ALSA
+
+typedef struct _snd_seq snd_seq_t;
+typedef struct snd_midi_event snd_midi_event_t;
+
+/**
+ * Sends MIDI messages to an ALSA sequencer port through its own sequencer client, buffering
+ * the events of a burst and writing them to the sequencer with a single drain.
+ *
+ * JUCE's MidiOutput drains the sequencer output for every single event, which costs a system
+ * call per message for chords, MPE notes with their expression and trains of SysEx messages.
+ * Setting the RECEIVEMIDI_NO_ALSA_BATCHING environment variable turns the batching off.
+ */
+class AlsaBatchedOutput
+{
+public:
+    static std::unique_ptr<AlsaBatchedOutput> open(const String& name);
+
+    ~AlsaBatchedOutput();
+
+    void enqueue(const MidiMessage& msg);
+    void drain();
+
+    int64 getNumMessages() const;
+    int64 getNumDrains() const;
+
+private:
+    static constexpr size_t OUTPUT_BUFFER_SIZE = 64 * 1024;
+
+    AlsaBatchedOutput(snd_seq_t* seq, int port, snd_midi_event_t* parser);
+
+    snd_seq_t* seq_;
+    int port_;
+    snd_midi_event_t* parser_;
+    size_t parserSize_;
+    bool pending_               { false };
+    int64 messages_             { 0 };
+    int64 drains_               { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AlsaBatchedOutput)
+};
+
+#endif
@@ -19,6 +19,8 @@
 #include "ApplicationCommand.h"
 
 #include "ApplicationState.h"
+#include "FilterExpression.h"
+#include "SysexMatcher.h"
 
 ApplicationCommand ApplicationCommand::Dummy()
 {
@@ -33,6 +35,8 @@ void ApplicationCommand::clear()
     optionsDescriptions_ = StringArray({""});
     commandDescriptions_ = StringArray({""});
     opts_.clear();
+    expression_ = nullptr;
+    sysexMatcher_ = nullptr;
 }
 
 void ApplicationCommand::filter(ApplicationState& state, const MidiMessage& msg, DisplayState& display) const
@@ -40,72 +44,45 @@ void ApplicationCommand::filter(ApplicationState& state, const MidiMessage& msg,
     switch (command_)
     {
         case CHANNEL:
-            display.channel = state.asDecOrHex7BitValue(opts_[0]);
+            display.channels = channels_;
             break;
         case VOICE:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 (msg.isNoteOnOrOff() || msg.isAftertouch() || msg.isController() ||
                  msg.isProgramChange() || msg.isChannelPressure() || msg.isPitchWheel());
             break;
         case NOTE:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isNoteOnOrOff();
             break;
         case NOTE_ON:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isNoteOn() &&
-                (opts_.isEmpty() || (msg.getNoteNumber() == state.asNoteNumber(opts_[0])));
+                checkValue(msg.getNoteNumber());
             break;
         case NOTE_OFF:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isNoteOff() &&
-                (opts_.isEmpty() || (msg.getNoteNumber() == state.asNoteNumber(opts_[0])));
+                checkValue(msg.getNoteNumber());
             break;
         case POLY_PRESSURE:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isAftertouch() &&
-                (opts_.isEmpty() || (msg.getNoteNumber() == state.asNoteNumber(opts_[0])));
+                checkValue(msg.getNoteNumber());
             break;
         case CONTROL_CHANGE:
-            display.displayControlChange = checkChannel(msg, display.channel) &&
+            display.displayControlChange = checkChannel(msg, display.channels) &&
                 msg.isController() &&
-                (opts_.isEmpty() || (msg.getControllerNumber() == state.asDecOrHex7BitValue(opts_[0])));
+                checkValue(msg.getControllerNumber());
             display.filtered |= display.displayControlChange;
             break;
         case CONTROL_CHANGE_14BIT:
-            if (checkChannel(msg, display.channel) &&
+            if (checkChannel(msg, display.channels) &&
                 msg.isController() &&
                 msg.getControllerNumber() < 64 &&
-                (opts_.isEmpty() || (msg.getControllerNumber() == state.asDecOrHex7BitValue(opts_[0]))))
+                checkValue(msg.getControllerNumber()))
             {
-                uint8 ch = (uint8)msg.getChannel() - 1;
-                uint8 cc = (uint8)msg.getControllerNumber();
-                uint8 v = (uint8)msg.getControllerValue();
-                uint8 prev_v = (uint8)state.lastCC_[ch][cc];
-                state.lastCC_[ch][cc] = v;
-                
-                // handle 14-bit MIDI CC values as appropriate
-                if (cc < 32)
-                {
-                    // only trigger an MSB-initiated change when its value is different than before
-                    // if it's the same, wait for the LSB to trigger the change
-                    if (v != prev_v)
-                    {
-                        uint8 lsb_cc = cc + 32;
-                        state.lastCC_[ch][lsb_cc] = 0;
-                        display.displayControlChange14bit = true;
-                    }
-                }
-                // handle 14-bit MIDI CC LSB values
-                else if (cc >= 32 && cc < 64)
-                {
-                    uint8 msb_cc = cc - 32;
-                    int msb = state.lastCC_[ch][msb_cc];
-                    if (msb >= 0)
-                    {
-                        display.displayControlChange14bit = true;
-                    }
-                }
+                display.displayControlChange14bit |= display.controlChange14bit;
             }
             
             display.displayControlChange = display.displayControlChange14bit;
@@ -113,43 +90,35 @@ void ApplicationCommand::filter(ApplicationState& state, const MidiMessage& msg,
             break;
         case NRPN:
         case NRPN_FULL:
-            if (checkChannel(msg, display.channel) && msg.isController())
+            if (checkChannel(msg, display.channels) && display.parameter)
             {
-                auto nrpn = state.rpnDetector_.tryParse(msg.getChannel(), msg.getControllerNumber(), msg.getControllerValue());
-                if (nrpn.has_value())
-                {
-                    display.displayNrpn = state.rpnMsg_.isNRPN &&
-                        (command_ == NRPN || (command_ == NRPN_FULL && state.rpnMsg_.is14BitValue)) &&
-                        (opts_.isEmpty() || (state.rpnMsg_.parameterNumber == state.asDecOrHex14BitValue(opts_[0])));
-                        display.filtered |= display.displayNrpn;
-                }
+                display.displayNrpn = display.parameterIsNrpn &&
+                    (command_ == NRPN || (command_ == NRPN_FULL && display.parameterIs14bit)) &&
+                    (parameter_ < 0 || display.parameterNumber == parameter_);
+                display.filtered |= display.displayNrpn;
             }
             break;
         case RPN:
         case RPN_FULL:
-            if (checkChannel(msg, display.channel) && msg.isController())
+            if (checkChannel(msg, display.channels) && display.parameter)
             {
-                auto rpn = state.rpnDetector_.tryParse(msg.getChannel(), msg.getControllerNumber(), msg.getControllerValue());
-                if (rpn.has_value())
-                {
-                    display.displayRpn = !state.rpnMsg_.isNRPN &&
-                        (command_ == RPN || (command_ == RPN_FULL && state.rpnMsg_.is14BitValue)) &&
-                        (opts_.isEmpty() || (state.rpnMsg_.parameterNumber == state.asDecOrHex14BitValue(opts_[0])));
-                        display.filtered |= display.displayRpn;
-                }
+                display.displayRpn = !display.parameterIsNrpn &&
+                    (command_ == RPN || (command_ == RPN_FULL && display.parameterIs14bit)) &&
+                    (parameter_ < 0 || display.parameterNumber == parameter_);
+                display.filtered |= display.displayRpn;
             }
             break;
         case PROGRAM_CHANGE:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isProgramChange() &&
-                (opts_.isEmpty() || (msg.getProgramChangeNumber() == state.asDecOrHex7BitValue(opts_[0])));
+                checkValue(msg.getProgramChangeNumber());
             break;
         case CHANNEL_PRESSURE:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isChannelPressure();
             break;
         case PITCH_BEND:
-            display.filtered |= checkChannel(msg, display.channel) &&
+            display.filtered |= checkChannel(msg, display.channels) &&
                 msg.isPitchWheel();
             break;
 
@@ -185,6 +154,16 @@ void ApplicationCommand::filter(ApplicationState& state, const MidiMessage& msg,
         case SYSTEM_EXCLUSIVE_FILE:
             display.filtered |= msg.isSysEx();
             break;
+        case SYSEX_MATCH:
+            display.filtered |= msg.isSysEx() && sysexMatcher_->matches(msg.getRawData(), msg.getRawDataSize());
+            break;
+        case FILTER_EXPRESSION:
+            if (expression_->matches(msg, state.getInputPortName()))
+            {
+                display.displayControlChange |= msg.isController();
+                display.filtered = true;
+            }
+            break;
         case TIME_CODE:
             display.filtered |= msg.isQuarterFrame();
             break;
@@ -203,7 +182,113 @@ void ApplicationCommand::filter(ApplicationState& state, const MidiMessage& msg,
     }
 }
 
-bool ApplicationCommand::checkChannel(const MidiMessage& msg, int channel) const
+void ApplicationCommand::filterUniversalPacket(ApplicationState& state, const ump::View& packet, DisplayState& display) const
+{
+    // MIDI 2.0 Channel Voice messages are filtered on their own fields, without MIDI 1.0 translation
+    auto word = packet[0];
+    auto status = ump::Utils::getStatus(word);
+    auto channel_matches = ((display.channels >> ump::Utils::getChannel(word)) & 1) != 0;
+    auto byte2 = (uint8)((word >> 8) & 0x7f);
+    auto byte3 = (uint8)(word & 0x7f);
+    
+    switch (command_)
+    {
+        case CHANNEL:
+            display.channels = channels_;
+            break;
+        case VOICE:
+            display.filtered |= channel_matches;
+            break;
+        case NOTE:
+            display.filtered |= channel_matches && (status == 0x8 || status == 0x9);
+            break;
+        case NOTE_ON:
+            display.filtered |= channel_matches && status == 0x9 &&
+                checkValue(byte2);
+            break;
+        case NOTE_OFF:
+            display.filtered |= channel_matches && status == 0x8 &&
+                checkValue(byte2);
+            break;
+        case POLY_PRESSURE:
+            display.filtered |= channel_matches && status == 0xa &&
+                checkValue(byte2);
+            break;
+        case CONTROL_CHANGE:
+            display.filtered |= channel_matches && status == 0xb &&
+                checkValue(byte2);
+            break;
+        case NRPN:
+        case NRPN_FULL:
+            display.filtered |= channel_matches && (status == 0x3 || status == 0x5) &&
+                (parameter_ < 0 || ((byte2 << 7) | byte3) == parameter_);
+            break;
+        case RPN:
+        case RPN_FULL:
+            display.filtered |= channel_matches && (status == 0x2 || status == 0x4) &&
+                (parameter_ < 0 || ((byte2 << 7) | byte3) == parameter_);
+            break;
+        case PROGRAM_CHANGE:
+            display.filtered |= channel_matches && status == 0xc &&
+                checkValue((int)((packet[1] >> 24) & 0x7f));
+            break;
+        case CHANNEL_PRESSURE:
+            display.filtered |= channel_matches && status == 0xd;
+            break;
+        case PITCH_BEND:
+            display.filtered |= channel_matches && status == 0xe;
+            break;
+        case FILTER_EXPRESSION:
+            display.filtered |= expression_->matchesUniversalPacket(packet.data(), state.getInputPortName());
+            break;
+        default:
+            // no-op
+            break;
+    }
+}
+
+bool ApplicationCommand::checkChannel(const MidiMessage& msg, uint16 channels) const
 {
-    return channel == 0 || msg.getChannel() == channel;
+    return ((channels >> (msg.getChannel() - 1)) & 1) != 0;
+}
+
+void ApplicationCommand::compileMasks(const ApplicationState& state)
+{
+    // the options of the filters can be lists and ranges, which are turned into masks so that
+    // the filters don't need to parse the options for each message
+    if (opts_.isEmpty())
+    {
+        return;
+    }
+    
+    switch (command_)
+    {
+        case CHANNEL:
+        {
+            BigInteger channels = state.asValueSet(opts_[0], false, 0, 16);
+            channels_ = channels[0] ? 0xffff : (uint16)(channels.getBitRangeAsInt(1, 16));
+            break;
+        }
+        case NOTE_ON:
+        case NOTE_OFF:
+        case POLY_PRESSURE:
+        case CONTROL_CHANGE:
+        case CONTROL_CHANGE_14BIT:
+        case PROGRAM_CHANGE:
+        {
+            const bool noteNames = command_ == NOTE_ON || command_ == NOTE_OFF || command_ == POLY_PRESSURE;
+            BigInteger values = state.asValueSet(opts_[0], noteNames, 0, 127);
+            values_[0] = (uint64)values.getBitRangeAsInt(0, 32) | (uint64)values.getBitRangeAsInt(32, 32) << 32;
+            values_[1] = (uint64)values.getBitRangeAsInt(64, 32) | (uint64)values.getBitRangeAsInt(96, 32) << 32;
+            break;
+        }
+        case NRPN:
+        case NRPN_FULL:
+        case RPN:
+        case RPN_FULL:
+            parameter_ = state.asDecOrHex14BitValue(opts_[0]);
+            break;
+        default:
+            break;
+    }
 }
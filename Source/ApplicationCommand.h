@@ -20,6 +20,8 @@
 
 #include "JuceHeader.h"
 
+#include "UniversalMidiPackets.h"
+
 #include "DisplayState.h"
 
 enum CommandIndex
@@ -28,8 +30,14 @@ enum CommandIndex
     LIST,
     DEVICE,
     VIRTUAL,
+    RTP_MIDI,
+    UMP_FILE,
     PASSTHROUGH,
+    PASS_TRANSFORM,
+    PASS_DELAY,
+    ROUTE,
     TXTFILE,
+    CONTROL,
     DECIMAL,
     HEXADECIMAL,
     CHANNEL,
@@ -58,14 +66,31 @@ enum CommandIndex
     ACTIVE_SENSING,
     RESET,
     SYSTEM_EXCLUSIVE,
+    SYSEX_MATCH,
     SYSTEM_EXCLUSIVE_FILE,
+    SYSEX_NUMBERED,
+    SYSEX_ROTATE_SIZE,
+    SYSEX_ROTATE_TIME,
+    SYSEX_GZIP,
     SYSTEM_COMMON,
     TIME_CODE,
     SONG_POSITION,
     SONG_SELECT,
     TUNE_REQUEST,
+    FILTER_EXPRESSION,
     QUIET,
     RAWDUMP,
+    JSON_LINES,
+    CSV_EXPORT,
+    STATISTICS,
+    METRICS,
+    TRACE,
+    DASHBOARD,
+    COALESCE,
+    SINK,
+    SERVE,
+    SHARED_MEMORY,
+    RECORDER,
     JAVASCRIPT,
     JAVASCRIPT_FILE,
     MPE_PROFILE,
@@ -76,6 +101,8 @@ enum CommandIndex
 };
 
 class ApplicationState;
+class FilterExpression;
+class SysexMatcher;
 
 struct ApplicationCommand
 {
@@ -83,7 +110,10 @@ struct ApplicationCommand
     
     void clear();
     void filter(ApplicationState& state, const MidiMessage& msg, DisplayState& display) const;
-    bool checkChannel(const MidiMessage& msg, int channel) const;
+    void filterUniversalPacket(ApplicationState& state, const ump::View& packet, DisplayState& display) const;
+    void compileMasks(const ApplicationState& state);
+    bool checkChannel(const MidiMessage& msg, uint16 channels) const;
+    bool checkValue(int value) const { return (values_[value >> 6] >> (value & 63)) & 1; }
     
     String param_;
     String altParam_;
@@ -92,4 +122,12 @@ struct ApplicationCommand
     StringArray optionsDescriptions_;
     StringArray commandDescriptions_;
     StringArray opts_;
+    std::shared_ptr<const FilterExpression> expression_;
+    std::shared_ptr<const SysexMatcher> sysexMatcher_;
+    
+    // membership masks of the values and channels, and the (N)RPN parameter number in the
+    // options, compiled once
+    uint64 values_[2]   { ~(uint64)0, ~(uint64)0 };
+    uint16 channels_    { 0xffff };
+    int parameter_      { -1 };
 };
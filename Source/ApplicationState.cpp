@@ -22,6 +22,7 @@
 #include "ScriptUtilClass.h"
 
 static const int DEFAULT_OCTAVE_MIDDLE_C = 3;
+static const int DEFAULT_DASHBOARD_RATE = 10;
 static const String& DEFAULT_VIRTUAL_NAME = "ReceiveMIDI";
 
 inline float sign(float value)
@@ -33,27 +34,40 @@ ApplicationState::ApplicationState()
 {
     commands_.add({"dev",   "device",                   DEVICE,                1, {"name"},             {"Set the name of the MIDI input port"}});
     commands_.add({"virt",  "virtual",                  VIRTUAL,              -1, {"(name)"},           {"Use virtual MIDI port with optional name (Linux/macOS)"}});
+    commands_.add({"rtp",   "rtp-midi",                 RTP_MIDI,              1, {"port"},             {"Listen for RTP-MIDI network sessions on UDP port (and +1)"}});
+    commands_.add({"ump",   "ump-file",                 UMP_FILE,              1, {"path"},             {"Read Universal MIDI Packets from a file, - for stdin"}});
     commands_.add({"pass",  "pass-through",             PASSTHROUGH,           1, {"name"},             {"Set name of MIDI output port for MIDI pass-through"}});
+    commands_.add({"tf",    "transform",                PASS_TRANSFORM,        1, {"spec"},             {"Transform the pass-through messages, for instance \"on 1 ch 2",
+                                                                                   "transpose -12 clamp C1-B4 vel 0.7 ccmap 1>74 ccscale 7>0-100\""}});
+    commands_.add({"pd",    "pass-delay",               PASS_DELAY,            1, {"ms"},               {"Send pass-through messages at a constant delay after they",
+                                                                                   "were received and report the output jitter on exit"}});
+    commands_.add({"route", "",                         ROUTE,                 3, {"name", "filter", "transform"},
+                                                                                  {"Pass messages that match the filter through to this MIDI",
+                                                                                   "output port after the transform, - for none, for instance",
+                                                                                   "\"ch 1 note C-2-B3\" with \"ch 2 transpose 12 vel 0.7\""}});
     commands_.add({"list",  "",                         LIST,                  0, {""},                 {"Lists the MIDI input ports"}});
     commands_.add({"file",  "",                         TXTFILE,               1, {"path"},             {"Loads commands from the specified program file"}});
+    commands_.add({"ctl",   "control",                  CONTROL,              -1, {"(port)"},           {"Keep reading filters, routes, transforms and scripts while",
+                                                                                   "running, a line at a time from standard input (Linux/macOS)",
+                                                                                   "or from the clients of a localhost TCP port"}});
     commands_.add({"dec",   "decimal",                  DECIMAL,               0, {""},                 {"Interpret the next numbers as decimals by default"}});
     commands_.add({"hex",   "hexadecimal",              HEXADECIMAL,           0, {""},                 {"Interpret the next numbers as hexadecimals by default"}});
-    commands_.add({"ch",    "channel",                  CHANNEL,               1, {"number"},           {"Set MIDI channel for the commands (0-16), defaults to 0"}});
+    commands_.add({"ch",    "channel",                  CHANNEL,               1, {"number"},           {"Set MIDI channels for the commands (0-16), defaults to 0"}});
     commands_.add({"ts",    "timestamp",                TIMESTAMP,             0, {""},                 {"Output a timestamp for each received MIDI message"}});
     commands_.add({"nn",    "note-numbers",             NOTE_NUMBERS,          0, {""},                 {"Output notes as numbers instead of names"}});
     commands_.add({"omc",   "octave-middle-c",          OCTAVE_MIDDLE_C,       1, {"number"},           {"Set octave for middle C, defaults to 3"}});
     commands_.add({"voice", "",                         VOICE,                 0, {""},                 {"Show all Channel Voice messages"}});
     commands_.add({"note",  "",                         NOTE,                  0, {""},                 {"Show all Note messages"}});
-    commands_.add({"on",    "note-on",                  NOTE_ON,              -1, {"(note)"},           {"Show Note On, optionally for note (0-127)"}});
-    commands_.add({"off",   "note-off",                 NOTE_OFF,             -1, {"(note)"},           {"Show Note Off, optionally for note (0-127)"}});
-    commands_.add({"pp",    "poly-pressure",            POLY_PRESSURE,        -1, {"(note)"},           {"Show Poly Pressure, optionally for note (0-127)"}});
-    commands_.add({"cc",    "control-change",           CONTROL_CHANGE,       -1, {"(number)"},         {"Show Control Change, optionally for controller (0-127)"}});
-    commands_.add({"cc14",  "control-change-14",        CONTROL_CHANGE_14BIT, -1, {"(number)"},         {"Show 14-bit CC, optionally for controller (0-63)"}});
+    commands_.add({"on",    "note-on",                  NOTE_ON,              -1, {"(note)"},           {"Show Note On, optionally for notes (0-127)"}});
+    commands_.add({"off",   "note-off",                 NOTE_OFF,             -1, {"(note)"},           {"Show Note Off, optionally for notes (0-127)"}});
+    commands_.add({"pp",    "poly-pressure",            POLY_PRESSURE,        -1, {"(note)"},           {"Show Poly Pressure, optionally for notes (0-127)"}});
+    commands_.add({"cc",    "control-change",           CONTROL_CHANGE,       -1, {"(number)"},         {"Show Control Change, optionally for controllers (0-127)"}});
+    commands_.add({"cc14",  "control-change-14",        CONTROL_CHANGE_14BIT, -1, {"(number)"},         {"Show 14-bit CC, optionally for controllers (0-63)"}});
     commands_.add({"nrpn",  "",                         NRPN,                 -1, {"(number)"},         {"Show NRPN, optionally for parameter (0-16383)"}});
     commands_.add({"nrpnf", "nrpn-full",                NRPN_FULL,            -1, {"(number)"},         {"Show full NRPN (MSB+LSB), optionally for parameter (0-16383)"}});
     commands_.add({"rpn",   "",                         RPN,                  -1, {"(number)"},         {"Show RPN, optionally for parameter (0-16383)"}});
     commands_.add({"rpnf",  "rpn-full",                 RPN_FULL,             -1, {"(number)"},         {"Show full RPN (MSB+LSB), optionally for parameter (0-16383)"}});
-    commands_.add({"pc",    "program-change",           PROGRAM_CHANGE,       -1, {"(number)"},         {"Show Program Change, optionally for program (0-127)"}});
+    commands_.add({"pc",    "program-change",           PROGRAM_CHANGE,       -1, {"(number)"},         {"Show Program Change, optionally for programs (0-127)"}});
     commands_.add({"cp",    "channel-pressure",         CHANNEL_PRESSURE,      0, {""},                 {"Show Channel Pressure"}});
     commands_.add({"pb",    "pitch-bend",               PITCH_BEND,            0, {""},                 {"Show Pitch Bend"}});
     commands_.add({"sr",    "system-realtime",          SYSTEM_REALTIME,       0, {""},                 {"Show all System Real-Time messages"}});
@@ -65,13 +79,49 @@ ApplicationState::ApplicationState()
     commands_.add({"rst",   "reset",                    RESET,                 0, {""},                 {"Show Reset"}});
     commands_.add({"sc",    "system-common",            SYSTEM_COMMON,         0, {""},                 {"Show all System Common messages"}});
     commands_.add({"syx",   "system-exclusive",         SYSTEM_EXCLUSIVE,      0, {""},                 {"Show System Exclusive"}});
+    commands_.add({"syxm",  "sysex-match",              SYSEX_MATCH,           1, {"patterns"},         {"Show SysEx containing any of the comma-separated hex patterns,",
+                                                                                   "?? matches any byte and a leading F0 only matches the start"}});
     commands_.add({"syf",   "system-exclusive-file",    SYSTEM_EXCLUSIVE_FILE, 1, {"path"},             {"Store SysEx into a .syx file"}});
+    commands_.add({"syn",   "sysex-numbered",           SYSEX_NUMBERED,        0, {""},                 {"Store each SysEx message of the next syf in a numbered file"}});
+    commands_.add({"syrs",  "sysex-rotate-size",        SYSEX_ROTATE_SIZE,     1, {"size"},             {"Continue the next syf in a new numbered file after size in KB"}});
+    commands_.add({"syrt",  "sysex-rotate-time",        SYSEX_ROTATE_TIME,     1, {"secs"},             {"Continue the next syf in a new file after a number of seconds"}});
+    commands_.add({"syz",   "sysex-gzip",               SYSEX_GZIP,            0, {""},                 {"Compress the files of the next syf with gzip once closed"}});
     commands_.add({"tc",    "time-code",                TIME_CODE,             0, {""},                 {"Show MIDI Time Code Quarter Frame"}});
     commands_.add({"spp",   "song-position",            SONG_POSITION,         0, {""},                 {"Show Song Position Pointer"}});
     commands_.add({"ss",    "song-select",              SONG_SELECT,           0, {""},                 {"Show Song Select"}});
     commands_.add({"tun",   "tune-request",             TUNE_REQUEST,          0, {""},                 {"Show Tune Request"}});
+    commands_.add({"fx",    "filter-expression",        FILTER_EXPRESSION,     1, {"expr"},             {"Show messages that match a boolean expression of types and",
+                                                                                   "fields, for instance \"on and ch 2-4 and vel > 100\""}});
     commands_.add({"q",     "quiet",                    QUIET,                 0, {""},                 {"Don't show the received messages on standard output"}});
     commands_.add({"dump",  "",                         RAWDUMP,               0, {""},                 {"Dump the received messages 1:1 on standard output"}});
+    commands_.add({"json",  "json-lines",               JSON_LINES,            0, {""},                 {"Output the received messages as JSON Lines on standard output"}});
+    commands_.add({"csv",   "csv-export",               CSV_EXPORT,            1, {"path"},             {"Export the received messages as CSV columns to a file"}});
+    commands_.add({"stats", "statistics",               STATISTICS,            1, {"secs"},             {"Show a summary of the received messages every number of seconds"}});
+    commands_.add({"met",   "metrics",                  METRICS,               2, {"path", "secs"},     {"Write counters and stage latencies in the Prometheus text",
+                                                                                   "format to a file every number of seconds and on SIGUSR1",
+                                                                                   "(Linux/macOS), with a summary on exit"}});
+    commands_.add({"trc",   "trace",                    TRACE,                 1, {"path"},             {"Trace the processing stages of each message and write the latest",
+                                                                                   "spans of each thread to a Chrome trace JSON file on exit"}});
+    commands_.add({"top",   "dashboard",                DASHBOARD,            -1, {"(fps)"},            {"Show a live full-screen overview, optionally frames per second"}});
+    commands_.add({"co",    "coalesce",                 COALESCE,              1, {"ms"},               {"Only keep the latest controller, pitch bend and pressure value",
+                                                                                   "of each port, channel and number within windows of ms (1-1000),",
+                                                                                   "0 to stop coalescing"}});
+    commands_.add({"sink",  "",                         SINK,                  3, {"type", "target", "policy"},
+                                                                                  {"Send messages to an additional sink with its own queue, type",
+                                                                                   "text with - for the standard output, raw, port, udp or osc",
+                                                                                   "with a file (- for stdout), port name or host:port as target,",
+                                                                                   "and overflow policy block, drop-oldest, drop-newest or coalesce"}});
+    commands_.add({"serve", "",                         SERVE,                 3, {"target", "format", "policy"},
+                                                                                  {"Stream messages to the clients of a Unix socket path or of",
+                                                                                   "a localhost TCP port number as target (Linux), as raw MIDI",
+                                                                                   "bytes or text lines, and disconnect or drop for slow clients"}});
+    commands_.add({"shm",   "shared-memory",            SHARED_MEMORY,         1, {"name"},             {"Publish messages to a shared memory ring for local readers",
+                                                                                   "(Linux/macOS), the layout is in SharedMemoryRing.h"}});
+    commands_.add({"rec",   "recorder",                 RECORDER,              3, {"path", "secs", "size"},
+                                                                                  {"Keep the last seconds, at most size KB, of messages in memory",
+                                                                                   "without showing them, and write them to a numbered MIDI file",
+                                                                                   "when a filter matches, on SIGUSR1 (Linux/macOS) or when a",
+                                                                                   "script calls MIDI.record()"}});
     commands_.add({"js",    "javascript",               JAVASCRIPT,            1, {"code"},             {"Execute this script for each received MIDI message"}});
     commands_.add({"jsf",   "javascript-file",          JAVASCRIPT_FILE,       1, {"path"},             {"Execute the script in this file for each message"}});
     commands_.add({"mpp",   "mpe-profile",              MPE_PROFILE,           3, {"name", "manager", "members"},
@@ -88,20 +138,37 @@ ApplicationState::ApplicationState()
     noteNumbersOutput_ = false;
     octaveMiddleC_ = DEFAULT_OCTAVE_MIDDLE_C;
     useHexadecimalsByDefault_ = false;
+    parseHexadecimals_ = false;
     quiet_ = false;
     rawdump_ = false;
+    jsonOutput_ = false;
+    dashboardRate_ = 0;
+    passDelay_ = 0.0;
+    textSink_ = nullptr;
+    replacedParts_ = LiveConfiguration::ALL_PARTS;
+    lineFailed_ = false;
+    running_ = false;
+    controlPort_ = -1;
     currentCommand_ = ApplicationCommand::Dummy();
     
+    controllerState_ = std::make_unique<ControllerState>();
+    controllerDecoder_ = std::make_unique<ControllerDecoder>(*controllerState_);
     mpeProfile_ = std::make_unique<MpeProfileNegotiation>();
-    
-    // initialize last CC MSB values
-    for (int ch = 0; ch < 16; ++ch)
-    {
-        for (int cc = 0; cc < 128; ++cc)
-        {
-            lastCC_[ch][cc] = -1;
-        }
-    }
+    sysexOutput_ = std::make_unique<SysexFileOutput>();
+    recorder_ = std::make_unique<FlightRecorder>();
+    jsonWriter_ = std::make_unique<JsonLinesWriter>();
+    csvExport_ = std::make_unique<CsvExport>();
+    statistics_ = std::make_unique<MessageStatistics>(*controllerState_);
+    dashboard_ = std::make_unique<TerminalDashboard>(*controllerState_);
+    coalescer_ = std::make_unique<MessageCoalescer>(*this);
+    passScheduler_ = std::make_unique<DejitteredOutput>();
+    server_ = std::make_unique<StreamServer>();
+    sharedMemory_ = std::make_unique<SharedMemoryPublisher>();
+    metrics_ = std::make_unique<Metrics>(*this);
+    tracer_ = std::make_unique<MessageTracer>();
+    live_ = std::make_unique<LiveConfiguration>();
+    pending_ = LiveConfiguration::createEmpty();
+    commandChannel_ = std::make_unique<CommandChannel>(*this);
 }
 
 void ApplicationState::initialise(JUCEApplicationBase& app)
@@ -128,7 +195,8 @@ void ApplicationState::initialise(JUCEApplicationBase& app)
     
     parseParameters(cmdLineParams);
     
-    if (cmdLineParams.contains("--"))
+    // with a control channel on standard input, its lines are read while running instead
+    if (cmdLineParams.contains("--") && controlPort_ != 0)
     {
         while (std::cin)
         {
@@ -139,6 +207,9 @@ void ApplicationState::initialise(JUCEApplicationBase& app)
         }
     }
     
+    live_->install(std::move(pending_));
+    running_ = true;
+    
     if (cmdLineParams.isEmpty())
     {
         printUsage();
@@ -146,6 +217,33 @@ void ApplicationState::initialise(JUCEApplicationBase& app)
     }
     else
     {
+        if (dashboardRate_ > 0)
+        {
+            dashboard_->start(dashboardRate_, noteNumbersOutput_, octaveMiddleC_);
+        }
+        
+        if (umpInPath_.isNotEmpty())
+        {
+            setInputPortName(umpInPath_);
+            umpIn_ = std::make_unique<UmpFileInput>(*this);
+            if (!umpIn_->start(umpInPath_))
+            {
+                std::cerr << "Couldn't find file \"" << umpInPath_ << "\"" << std::endl;
+                JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+                umpIn_ = nullptr;
+            }
+        }
+        
+        if (controlPort_ >= 0)
+        {
+            String error;
+            if (!commandChannel_->start(controlPort_, error))
+            {
+                std::cerr << error << std::endl;
+                JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+            }
+        }
+        
         startTimer(200);
     }
 }
@@ -165,6 +263,9 @@ bool ApplicationState::isMidiInDeviceAvailable(const String& name)
 
 void ApplicationState::timerCallback()
 {
+    recorder_->writePendingDump();
+    metrics_->writePendingExport();
+    
     if (fullMidiInName_.isNotEmpty() && !isMidiInDeviceAvailable(fullMidiInName_))
     {
         std::cerr << "MIDI input port \"" << fullMidiInName_ << "\" got disconnected, waiting" << std::endl;
@@ -183,11 +284,42 @@ void ApplicationState::timerCallback()
 
 void ApplicationState::shutdown()
 {
-    if (sysexOutput_)
-    {
-        sysexOutput_->flush();
-        sysexOutput_.reset();
-    }
+    // no new settings are installed while the outputs stop
+    commandChannel_->stop();
+    
+    // stop receiving before the files are closed
+    rtpIn_ = nullptr;
+    umpIn_ = nullptr;
+    midiIn_ = nullptr;
+    
+    // the pending coalesced values are sent to the outputs before they stop
+    coalescer_->stop();
+    metrics_->stop();
+    tracer_->stop();
+    dashboard_->stop();
+    passScheduler_->stop();
+    textSink_ = nullptr;
+    sinks_.clear();
+    server_->stop();
+    sharedMemory_->stop();
+    
+    sysexOutput_->close();
+    csvExport_->close();
+    
+    // the final interval is summarized on exit
+    statistics_->printSummary();
+}
+
+void ApplicationState::setInputPortName(const String& name)
+{
+    inputPortName_ = name;
+    jsonWriter_->setPort(name);
+    csvExport_->setPort(name);
+    statistics_->setPort(name);
+    dashboard_->setPort(name);
+    controllerState_->setPort(name);
+    coalescer_->setPort(name);
+    metrics_->setPort(name);
 }
 
 ApplicationCommand* ApplicationState::findApplicationCommand(const String& param)
@@ -235,6 +367,7 @@ void ApplicationState::handleVarArgCommand()
 
 void ApplicationState::openInputDevice(const String& name)
 {
+    rtpIn_ = nullptr;
     midiIn_ = nullptr;
     midiInName_ = name;
     
@@ -276,7 +409,6 @@ std::unique_ptr<MidiOutput> ApplicationState::openOutputDevice(const String& nam
     if (output == nullptr)
     {
         std::cerr << "Couldn't find MIDI output port \"" << output_name << "\"" << std::endl;
-        JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
     }
     
     return output;
@@ -295,10 +427,14 @@ void ApplicationState::parseParameters(StringArray& parameters)
             switch (cmd->command_)
             {
                 case DECIMAL:
-                    useHexadecimalsByDefault_ = false;
-                    break;
                 case HEXADECIMAL:
-                    useHexadecimalsByDefault_ = true;
+                    // while running, the radix only applies to the rest of the line, the output
+                    // keeps the one it was started with
+                    parseHexadecimals_ = (cmd->command_ == HEXADECIMAL);
+                    if (!running_)
+                    {
+                        useHexadecimalsByDefault_ = parseHexadecimals_;
+                    }
                     break;
                 default:
                     handleVarArgCommand();
@@ -345,65 +481,801 @@ void ApplicationState::parseFile(File file)
     parseParameters(parameters);
 }
 
-void ApplicationState::handleIncomingMidiMessage(MidiInput*, const MidiMessage& msg)
+bool ApplicationState::commandLineReceived(const String& line)
+{
+    StringArray params = parseLineAsParameters(line);
+    if (params.isEmpty())
+    {
+        return true;
+    }
+    
+    // the errors of the commands only reject this line, the radix starts from the one of the output
+    lineFailed_ = false;
+    parseHexadecimals_ = useHexadecimalsByDefault_;
+    
+    // each part of the settings that the line has commands for replaces the running one, the
+    // other parts are kept
+    pending_ = live_->createCopy();
+    replacedParts_ = 0;
+    parseParameters(params);
+    
+    if (currentCommand_.command_ != NONE)
+    {
+        std::cerr << "Missing options for command \"" << currentCommand_.param_ << "\"" << std::endl;
+        currentCommand_ = ApplicationCommand::Dummy();
+        lineFailed_ = true;
+    }
+    
+    const bool succeeded = !lineFailed_;
+    
+    if (succeeded)
+    {
+        live_->install(std::move(pending_));
+    }
+    else
+    {
+        std::cerr << "Ignored the commands \"" << line << "\"" << std::endl;
+    }
+    pending_ = nullptr;
+    
+    return succeeded;
+}
+
+void ApplicationState::commandFailed()
+{
+    // a command on a control line only rejects that line, the exit code is left alone
+    if (running_)
+    {
+        lineFailed_ = true;
+    }
+    else
+    {
+        JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+    }
+}
+
+LiveConfiguration::Settings& ApplicationState::editLive(int part)
+{
+    if ((replacedParts_ & part) == 0)
+    {
+        replacedParts_ |= part;
+        pending_->reset(part);
+    }
+    return *pending_;
+}
+
+bool ApplicationState::isLiveCommand(CommandIndex command)
+{
+    switch (command)
+    {
+        case NONE:
+        case TXTFILE:
+        case PASS_TRANSFORM:
+        case ROUTE:
+        case CHANNEL:
+        case VOICE:
+        case NOTE:
+        case NOTE_ON:
+        case NOTE_OFF:
+        case POLY_PRESSURE:
+        case CONTROL_CHANGE:
+        case CONTROL_CHANGE_14BIT:
+        case NRPN:
+        case NRPN_FULL:
+        case RPN:
+        case RPN_FULL:
+        case PROGRAM_CHANGE:
+        case CHANNEL_PRESSURE:
+        case PITCH_BEND:
+        case SYSTEM_REALTIME:
+        case CLOCK:
+        case START:
+        case STOP:
+        case CONTINUE:
+        case ACTIVE_SENSING:
+        case RESET:
+        case SYSTEM_EXCLUSIVE:
+        case SYSEX_MATCH:
+        case SYSTEM_COMMON:
+        case TIME_CODE:
+        case SONG_POSITION:
+        case SONG_SELECT:
+        case TUNE_REQUEST:
+        case FILTER_EXPRESSION:
+        case JAVASCRIPT:
+        case JAVASCRIPT_FILE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void ApplicationState::handleIncomingMidiMessage(MidiInput* source, const MidiMessage& msg)
 {
+    // a status byte that interrupts a SysEx message aborts it
+    if (sysexOutput_->hasPartial() && !msg.isSysEx() && msg.getRawData()[0] < 0xf8)
+    {
+        sysexOutput_->discardPartial();
+    }
+    
+#if JUCE_LINUX
+    // ALSA input is stamped in whole milliseconds, the time of arrival is taken again with the
+    // high resolution counter so that the pass-through delay doesn't keep that rounding as jitter
+    if (source != nullptr)
+    {
+        const MidiMessage stamped(msg, Time::getMillisecondCounterHiRes() * 0.001);
+        processMessage(&stamped, nullptr, 0);
+        return;
+    }
+#else
+    ignoreUnused(source);
+#endif
+    
+    processMessage(&msg, nullptr, 0);
+}
+
+void ApplicationState::handlePartialSysexMessage(MidiInput*, const uint8* data, int numBytesSoFar, double)
+{
+    sysexOutput_->writePartial(data, numBytesSoFar);
+}
+
+void ApplicationState::packetReceived(const ump::View& packet, double time)
+{
+    auto word = packet[0];
+    switch (ump::Utils::getMessageType(word))
+    {
+        // MIDI 1.0 system and channel voice messages carry their bytes as-is
+        case 0x1:
+        case 0x2:
+        {
+            uint8 data[3] = { (uint8)((word >> 16) & 0xff), (uint8)((word >> 8) & 0x7f), (uint8)(word & 0x7f) };
+            MidiMessage msg(data, MidiMessage::getMessageLengthFromFirstByte(data[0]), time);
+            processMessage(&msg, packet.data(), (int)packet.size());
+            break;
+        }
+        // 7-bit SysEx can be spread over several packets
+        case 0x3:
+        {
+            auto kind = (ump::SysEx7::Kind)ump::Utils::getStatus(word);
+            if (kind == ump::SysEx7::Kind::complete || kind == ump::SysEx7::Kind::begin)
+            {
+                umpSysex_.reset();
+                umpSysex_.append("\xf0", 1);
+                umpSysexWords_.clearQuick();
+            }
+            else if (umpSysex_.isEmpty())
+            {
+                break;
+            }
+            
+            auto bytes = ump::SysEx7::getDataBytes(ump::PacketX2 { packet[0], packet[1] });
+            umpSysex_.append(bytes.data.data(), bytes.size);
+            umpSysexWords_.addArray(packet.data(), (int)packet.size());
+            
+            if (kind == ump::SysEx7::Kind::complete || kind == ump::SysEx7::Kind::end)
+            {
+                umpSysex_.append("\xf7", 1);
+                MidiMessage msg(umpSysex_.getData(), (int)umpSysex_.getSize(), time);
+                processMessage(&msg, umpSysexWords_.getRawDataPointer(), umpSysexWords_.size());
+                umpSysex_.reset();
+            }
+            else
+            {
+                handlePartialSysexMessage(nullptr, (const uint8*)umpSysex_.getData(), (int)umpSysex_.getSize(), time);
+            }
+            break;
+        }
+        // MIDI 2.0 channel voice messages are handled natively, keeping their full resolution
+        case 0x4:
+            processMessage(nullptr, packet.data(), (int)packet.size());
+            break;
+        default:
+            // utility, data, flex data and stream messages are not displayed
+            break;
+    }
+}
+
+void ApplicationState::processMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords)
+{
+    LiveConfiguration::Reader live(*live_);
+    Metrics::StageTimer processTimer(*metrics_, Metrics::PROCESS);
+    MessageTracer::Span messageSpan(*tracer_, MessageTracer::MESSAGE, getStatusByte(msg, packetWords));
     DisplayState display;
+    bool matched = true;
+    {
+        Metrics::StageTimer filterTimer(*metrics_, Metrics::FILTER);
+        MessageTracer::Span filterSpan(*tracer_, MessageTracer::FILTER);
+        
+        // the recorder keeps all MIDI 1.0 messages, independently of the filters
+        if (msg != nullptr)
+        {
+            recorder_->record(msg->getRawData(), msg->getRawDataSize(), msg->getTimeStamp());
+            
+            // decode the controller state once, all filters and outputs share the result
+            controllerDecoder_->decode(*msg, display);
+        }
+        else
+        {
+            controllerDecoder_->decodeUniversalPacket(packetWords);
+        }
+        
+        if (!live->filters_.isEmpty())
+        {
+            display.filtered = false;
+            display.channels = 0xffff;
+            display.displayControlChange = false;
+            display.displayControlChange14bit = false;
+            
+            for (const ApplicationCommand& cmd : live->filters_)
+            {
+                if (msg != nullptr)
+                {
+                    cmd.filter(*this, *msg, display);
+                }
+                else
+                {
+                    cmd.filterUniversalPacket(*this, ump::View(packetWords), display);
+                }
+            }
+            matched = display.filtered;
+        }
+    }
+    
+    if (metrics_->isActive())
+    {
+        metrics_->countMessage(msg, matched);
+    }
+    
+    if (!matched)
+    {
+        // the SysEx file already received the partial data of this message
+        if (msg != nullptr && msg->isSysEx())
+        {
+            sysexOutput_->discardPartial();
+        }
+        return;
+    }
+    
+    if (!live->filters_.isEmpty() && recorder_->isActive())
+    {
+        recorder_->trigger();
+    }
     
-    if (!filterCommands_.isEmpty())
+    if (coalescer_->isActive())
     {
-        display.filtered = false;
-        display.channel = 0;
-        display.displayControlChange = false;
-        display.displayControlChange14bit = false;
+        coalescer_->process(msg, packetWords, numPacketWords, display);
+    }
+    else
+    {
+        processFilteredMessage(*live, msg, packetWords, numPacketWords, display);
+    }
+}
+
+void ApplicationState::coalescedMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display)
+{
+    LiveConfiguration::Reader live(*live_);
+    MessageTracer::Span messageSpan(*tracer_, MessageTracer::MESSAGE, getStatusByte(msg, packetWords));
+    processFilteredMessage(*live, msg, packetWords, numPacketWords, display);
+}
+
+void ApplicationState::processFilteredMessage(const LiveConfiguration::Settings& live, const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display)
+{
+    if (dashboard_->isActive())
+    {
+        if (msg != nullptr)
+        {
+            dashboard_->add(msg->getRawData(), msg->getRawDataSize());
+        }
+        else
+        {
+            dashboard_->addUniversalPacket(packetWords);
+        }
+    }
+    
+    // MIDI 2.0 messages have no MIDI 1.0 representation for the sinks, only the text sink
+    // writes them to standard output, in order with the other messages
+    for (auto* sink : sinks_)
+    {
+        if (msg != nullptr || sink == textSink_)
+        {
+            sink->push(msg, packetWords, numPacketWords, display);
+        }
+    }
+    
+    if (msg != nullptr)
+    {
+        if (server_->isActive())
+        {
+            server_->add(msg->getRawData(), msg->getRawDataSize(), msg->getTimeStamp());
+        }
         
-        for (ApplicationCommand& cmd : filterCommands_)
+        if (sharedMemory_->isActive())
+        {
+            sharedMemory_->publish(msg->getRawData(), msg->getRawDataSize(), msg->getTimeStamp());
+        }
+    }
+    
+    if (statistics_->isActive())
+    {
+        if (msg != nullptr)
+        {
+            statistics_->add(msg->getRawData(), msg->getRawDataSize(), msg->getTimeStamp());
+        }
+        else
+        {
+            statistics_->addUniversalPacket(packetWords, Time::getMillisecondCounterHiRes() * 0.001);
+        }
+    }
+    
+    if (msg != nullptr && csvExport_->isOpen())
+    {
+        csvExport_->add(msg->getTimeStamp(), msg->getRawData(), msg->getRawDataSize(), getDecoded14BitValue(*msg, display));
+    }
+    
+    // MIDI 2.0 messages have no MIDI 1.0 representation for pass-through or scripts
+    if (msg != nullptr)
+    {
+        if (msg->isSysEx())
         {
-            cmd.filter(*this, msg, display);
+            sysexOutput_->writeComplete(msg->getRawData(), msg->getRawDataSize());
         }
         
-        if (!display.filtered)
+        if (midiPass_)
         {
-            return;
+            Metrics::StageTimer timer(*metrics_, Metrics::PASS_THROUGH);
+            MessageTracer::Span span(*tracer_, MessageTracer::PASS_THROUGH);
+            if (live.transform_->isIdentity() || msg->getRawData()[0] >= 0xf0)
+            {
+                sendPassThrough(*msg);
+            }
+            else
+            {
+                uint8 transformed[3];
+                const int transformedSize = live.transform_->apply(msg->getRawData(), msg->getRawDataSize(), transformed);
+                if (transformedSize > 0)
+                {
+                    sendPassThrough(MidiMessage(transformed, transformedSize, msg->getTimeStamp()));
+                }
+            }
         }
+        
+        if (live.router_->hasRoutes())
+        {
+            live.router_->dispatch(*msg);
+        }
+        
+        if (live.scriptCode_.isNotEmpty())
+        {
+            Metrics::StageTimer timer(*metrics_, Metrics::SCRIPT);
+            MessageTracer::Span span(*tracer_, MessageTracer::SCRIPT);
+            scriptMidiMessage_->setDisplayState(display);
+            scriptMidiMessage_->setMidiMessage(*msg);
+            auto result = scriptEngine_.execute(live.scriptCode_);
+            if (result.failed())
+            {
+                std::cerr << result.getErrorMessage() << std::endl;
+            }
+            
+            if (metrics_->isActive())
+            {
+                metrics_->count(Metrics::SCRIPT_RUNS);
+                if (result.failed())
+                {
+                    metrics_->count(Metrics::SCRIPT_ERRORS);
+                }
+            }
+        }
+    }
+    
+    // with a text sink, standard output is only written by the thread of the sink
+    if (!quiet_ && textSink_ == nullptr)
+    {
+        Metrics::StageTimer timer(*metrics_, Metrics::OUTPUT);
+        MessageTracer::Span span(*tracer_, MessageTracer::OUTPUT);
+        outputReceivedMessage(msg, packetWords, numPacketWords, display);
+    }
+}
+
+void ApplicationState::collectQueues(Array<Metrics::Queue>& queues)
+{
+    for (auto* sink : sinks_)
+    {
+        Metrics::Queue queue;
+        queue.name_ = "sink " + sink->getThreadName();
+        sink->getQueueState(queue.depth_, queue.dropped_, queue.coalesced_);
+        queues.add(queue);
+    }
+    
+    if (passScheduler_->isActive())
+    {
+        Metrics::Queue queue;
+        queue.name_ = "pass-delay";
+        queue.depth_ = passScheduler_->getQueueDepth();
+        queue.dropped_ = passScheduler_->getDropped();
+        queues.add(queue);
+    }
+    
+    if (coalescer_->isActive())
+    {
+        Metrics::Queue queue;
+        queue.name_ = "coalesce";
+        coalescer_->getQueueState(queue.depth_, queue.coalesced_);
+        queues.add(queue);
+    }
+    
+    // the clients of the server buffer bytes rather than messages, only their drops are counted
+    if (server_->isActive())
+    {
+        Metrics::Queue queue;
+        queue.name_ = "serve";
+        queue.dropped_ = server_->getDropped();
+        queues.add(queue);
+    }
+}
+
+void ApplicationState::sendPassThrough(const MidiMessage& msg)
+{
+    if (metrics_->isActive())
+    {
+        metrics_->count(Metrics::PASS_THROUGH_MESSAGES);
+        metrics_->count(Metrics::PASS_THROUGH_BYTES, msg.getRawDataSize());
+    }
+    
+    if (passScheduler_->isActive())
+    {
+        passScheduler_->push(msg);
+    }
+    else
+    {
+        midiPass_->sendMessageNow(msg);
+    }
+}
+
+void ApplicationState::outputJson(const MidiMessage& msg, DisplayState& display) const
+{
+    JsonLinesWriter& json = *jsonWriter_;
+    const int64 channel = msg.getChannel();
+    
+    if (msg.isNoteOn())
+    {
+        json.begin("note-on");
+        json.add(JsonLinesWriter::CHANNEL, channel);
+        json.add(JsonLinesWriter::NOTE, (int64)msg.getNoteNumber());
+        json.add(JsonLinesWriter::VELOCITY, (int64)msg.getVelocity());
+    }
+    else if (msg.isNoteOff())
+    {
+        json.begin("note-off");
+        json.add(JsonLinesWriter::CHANNEL, channel);
+        json.add(JsonLinesWriter::NOTE, (int64)msg.getNoteNumber());
+        json.add(JsonLinesWriter::VELOCITY, (int64)msg.getVelocity());
+    }
+    else if (msg.isAftertouch())
+    {
+        json.begin("poly-pressure");
+        json.add(JsonLinesWriter::CHANNEL, channel);
+        json.add(JsonLinesWriter::NOTE, (int64)msg.getNoteNumber());
+        json.add(JsonLinesWriter::VALUE, (int64)msg.getAfterTouchValue());
+    }
+    else if (msg.isController())
+    {
+        // just like the text output, a controller can result in several decoded messages
+        if (display.displayControlChange)
+        {
+            if (display.displayControlChange14bit)
+            {
+                json.begin("cc14");
+                json.add(JsonLinesWriter::CHANNEL, channel);
+                json.add(JsonLinesWriter::NUMBER, (int64)display.controlChange14bitNumber);
+                json.add(JsonLinesWriter::VALUE, (int64)display.controlChange14bitValue);
+            }
+            else
+            {
+                json.begin("control-change");
+                json.add(JsonLinesWriter::CHANNEL, channel);
+                json.add(JsonLinesWriter::NUMBER, (int64)msg.getControllerNumber());
+                json.add(JsonLinesWriter::VALUE, (int64)msg.getControllerValue());
+            }
+            json.end(msg.getTimeStamp());
+        }
+        
+        if (display.displayNrpn || display.displayRpn)
+        {
+            if (display.displayNrpn)
+            {
+                json.begin("nrpn");
+            }
+            else
+            {
+                json.begin("rpn");
+            }
+            json.add(JsonLinesWriter::CHANNEL, channel);
+            json.add(JsonLinesWriter::NUMBER, (int64)display.parameterNumber);
+            json.add(JsonLinesWriter::VALUE, (int64)display.parameterValue);
+            json.end(msg.getTimeStamp());
+        }
+        return;
+    }
+    else if (msg.isProgramChange())
+    {
+        json.begin("program-change");
+        json.add(JsonLinesWriter::CHANNEL, channel);
+        json.add(JsonLinesWriter::PROGRAM, (int64)msg.getProgramChangeNumber());
+    }
+    else if (msg.isChannelPressure())
+    {
+        json.begin("channel-pressure");
+        json.add(JsonLinesWriter::CHANNEL, channel);
+        json.add(JsonLinesWriter::VALUE, (int64)msg.getChannelPressureValue());
+    }
+    else if (msg.isPitchWheel())
+    {
+        json.begin("pitch-bend");
+        json.add(JsonLinesWriter::CHANNEL, channel);
+        json.add(JsonLinesWriter::VALUE, (int64)msg.getPitchWheelValue());
+    }
+    else if (msg.isMidiClock())
+    {
+        json.begin("midi-clock");
+    }
+    else if (msg.isMidiStart())
+    {
+        json.begin("start");
+    }
+    else if (msg.isMidiStop())
+    {
+        json.begin("stop");
+    }
+    else if (msg.isMidiContinue())
+    {
+        json.begin("continue");
+    }
+    else if (msg.isActiveSense())
+    {
+        json.begin("active-sensing");
+    }
+    else if (msg.getRawDataSize() == 1 && msg.getRawData()[0] == 0xff)
+    {
+        json.begin("reset");
+    }
+    else if (msg.isSysEx())
+    {
+        if (sysexOutput_->isOpen())
+        {
+            json.begin("system-exclusive-file");
+            json.add(JsonLinesWriter::SIZE, (int64)msg.getRawDataSize());
+        }
+        else
+        {
+            json.begin("system-exclusive");
+            json.add(JsonLinesWriter::DATA, msg.getSysExData(), msg.getSysExDataSize());
+        }
+    }
+    else if (msg.isQuarterFrame())
+    {
+        json.begin("time-code");
+        json.add(JsonLinesWriter::SEQUENCE, (int64)msg.getQuarterFrameSequenceNumber());
+        json.add(JsonLinesWriter::VALUE, (int64)msg.getQuarterFrameValue());
+    }
+    else if (msg.isSongPositionPointer())
+    {
+        json.begin("song-position");
+        json.add(JsonLinesWriter::VALUE, (int64)msg.getSongPositionPointerMidiBeat());
+    }
+    else if (msg.getRawDataSize() == 2 && msg.getRawData()[0] == 0xf3)
+    {
+        json.begin("song-select");
+        json.add(JsonLinesWriter::VALUE, (int64)msg.getRawData()[1]);
+    }
+    else if (msg.getRawDataSize() == 1 && msg.getRawData()[0] == 0xf6)
+    {
+        json.begin("tune-request");
+    }
+    else
+    {
+        return;
     }
     
-    if (midiPass_)
+    json.end(msg.getTimeStamp());
+}
+
+void ApplicationState::outputJsonUniversalPacket(const ump::View& packet) const
+{
+    JsonLinesWriter& json = *jsonWriter_;
+    
+    auto word = packet[0];
+    auto value = packet[1];
+    auto byte2 = (int64)((word >> 8) & 0x7f);
+    auto byte3 = (int64)(word & 0xff);
+    
+    switch (ump::Utils::getStatus(word))
+    {
+        case 0x8:
+        case 0x9:
+            if (ump::Utils::getStatus(word) == 0x9)
+            {
+                json.begin("note-on");
+            }
+            else
+            {
+                json.begin("note-off");
+            }
+            json.add(JsonLinesWriter::NOTE, byte2);
+            json.add(JsonLinesWriter::VELOCITY, (int64)(value >> 16));
+            if (byte3 != 0)
+            {
+                json.add(JsonLinesWriter::ATTRIBUTE_TYPE, byte3);
+                json.add(JsonLinesWriter::ATTRIBUTE_VALUE, (int64)(value & 0xffff));
+            }
+            break;
+        case 0xa:
+            json.begin("poly-pressure");
+            json.add(JsonLinesWriter::NOTE, byte2);
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0xb:
+            json.begin("control-change");
+            json.add(JsonLinesWriter::NUMBER, byte2);
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0xc:
+            json.begin("program-change");
+            json.add(JsonLinesWriter::PROGRAM, (int64)((value >> 24) & 0x7f));
+            if ((word & 0x1) != 0)
+            {
+                json.add(JsonLinesWriter::BANK, (int64)(((value >> 8) & 0x7f) << 7 | (value & 0x7f)));
+            }
+            break;
+        case 0xd:
+            json.begin("channel-pressure");
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0xe:
+            json.begin("pitch-bend");
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0x0:
+        case 0x1:
+            if (ump::Utils::getStatus(word) == 0x0)
+            {
+                json.begin("per-note-rpn");
+            }
+            else
+            {
+                json.begin("per-note-nrpn");
+            }
+            json.add(JsonLinesWriter::NOTE, byte2);
+            json.add(JsonLinesWriter::INDEX, byte3);
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0x2:
+            json.begin("rpn");
+            json.add(JsonLinesWriter::NUMBER, byte2 << 7 | (byte3 & 0x7f));
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0x3:
+            json.begin("nrpn");
+            json.add(JsonLinesWriter::NUMBER, byte2 << 7 | (byte3 & 0x7f));
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0x4:
+            json.begin("rpn-relative");
+            json.add(JsonLinesWriter::NUMBER, byte2 << 7 | (byte3 & 0x7f));
+            json.add(JsonLinesWriter::VALUE, (int64)(int32)value);
+            break;
+        case 0x5:
+            json.begin("nrpn-relative");
+            json.add(JsonLinesWriter::NUMBER, byte2 << 7 | (byte3 & 0x7f));
+            json.add(JsonLinesWriter::VALUE, (int64)(int32)value);
+            break;
+        case 0x6:
+            json.begin("per-note-pitch-bend");
+            json.add(JsonLinesWriter::NOTE, byte2);
+            json.add(JsonLinesWriter::VALUE, (int64)value);
+            break;
+        case 0xf:
+            json.begin("per-note-management");
+            json.add(JsonLinesWriter::NOTE, byte2);
+            json.addFlag(JsonLinesWriter::DETACH, (byte3 & 0x2) != 0);
+            json.addFlag(JsonLinesWriter::RESET, (byte3 & 0x1) != 0);
+            break;
+        default:
+            json.begin("unknown-midi2");
+            json.add(JsonLinesWriter::WORDS, packet.data(), (int)packet.size());
+            break;
+    }
+    
+    json.add(JsonLinesWriter::GROUP, (int64)ump::Utils::getGroup(word) + 1);
+    json.add(JsonLinesWriter::CHANNEL, (int64)ump::Utils::getChannel(word) + 1);
+    json.end(Time::getMillisecondCounterHiRes() * 0.001);
+}
+
+void ApplicationState::dumpMessage(const MidiMessage& msg) const
+{
+    std::cout.write((char *)msg.getRawData(), msg.getRawDataSize());
+    std::cout.flush();
+}
+
+void ApplicationState::dumpUniversalPacket(const uint32* words, int numWords) const
+{
+    for (int i = 0; i < numWords; ++i)
+    {
+        uint32 word = ByteOrder::swapIfLittleEndian(words[i]);
+        std::cout.write((char *)&word, sizeof(word));
+    }
+    std::cout.flush();
+}
+
+int ApplicationState::getDecoded14BitValue(const MidiMessage& msg, const DisplayState& display) const
+{
+    if (msg.isPitchWheel())
+    {
+        return msg.getPitchWheelValue();
+    }
+    else if (msg.isSongPositionPointer())
+    {
+        return msg.getSongPositionPointerMidiBeat();
+    }
+    else if (msg.isController())
+    {
+        if (display.displayNrpn || display.displayRpn)
+        {
+            return display.parameterValue;
+        }
+        else if (display.displayControlChange14bit)
+        {
+            return display.controlChange14bitValue;
+        }
+    }
+    
+    return -1;
+}
+
+void ApplicationState::triggerRecorder()
+{
+    recorder_->trigger();
+}
+
+void ApplicationState::outputReceivedMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display) const
+{
+    if (quiet_)
     {
-        midiPass_->sendMessageNow(msg);
+        return;
     }
     
-    if (scriptCode_.isNotEmpty())
+    if (rawdump_ && packetWords != nullptr)
     {
-        scriptMidiMessage_->setDisplayState(display);
-        scriptMidiMessage_->setMidiMessage(msg);
-        auto result = scriptEngine_.execute(scriptCode_);
-        if (result.failed())
-        {
-            std::cerr << result.getErrorMessage() << std::endl;
-        }
+        dumpUniversalPacket(packetWords, numPacketWords);
     }
-    
-    if (!quiet_)
+    else if (msg != nullptr)
     {
         if (rawdump_)
         {
-            dumpMessage(msg);
+            dumpMessage(*msg);
         }
         else
         {
-            outputMessage(msg, display);
+            outputMessage(*msg, display);
         }
     }
-}
-
-void ApplicationState::dumpMessage(const MidiMessage& msg) const
-{
-    std::cout.write((char *)msg.getRawData(), msg.getRawDataSize());
-    std::cout.flush();
+    else if (jsonOutput_)
+    {
+        outputJsonUniversalPacket(ump::View(packetWords));
+    }
+    else
+    {
+        outputUniversalPacket(ump::View(packetWords));
+    }
 }
 
 void ApplicationState::outputMessage(const MidiMessage& msg, DisplayState& display) const
 {
+    if (jsonOutput_)
+    {
+        outputJson(msg, display);
+        return;
+    }
+    
     if (timestampOutput_)
     {
         Time t = Time::getCurrentTime();
@@ -434,17 +1306,9 @@ void ApplicationState::outputMessage(const MidiMessage& msg, DisplayState& displ
         {
             if (display.displayControlChange14bit)
             {
-                uint8 msb_cc = (uint8)msg.getControllerNumber();
-                if (msb_cc >= 32)
-                {
-                    msb_cc -= 32;
-                }
-                uint8 lsb_cc = (uint8)msb_cc + 32;
-                uint8 ch = (uint8)msg.getChannel() - 1;
-                uint16 v = ((lastCC_[ch][msb_cc] & 0x7f) << 7) | (lastCC_[ch][lsb_cc] & 0x7f);
                 std::cout << "channel "  << outputChannel(msg) << "   " <<
-                             "cc14             " << output7Bit(msb_cc).paddedLeft(' ', 3) << " "
-                << output14Bit(v).paddedLeft(' ', 5) << std::endl;
+                             "cc14             " << output7Bit(display.controlChange14bitNumber).paddedLeft(' ', 3) << " "
+                << output14Bit(display.controlChange14bitValue).paddedLeft(' ', 5) << std::endl;
             }
             else
             {
@@ -457,14 +1321,14 @@ void ApplicationState::outputMessage(const MidiMessage& msg, DisplayState& displ
         if (display.displayNrpn)
         {
             std::cout << "channel "  << outputChannel(msg) << "   " <<
-                         "nrpn           " << output14Bit(rpnMsg_.parameterNumber).paddedLeft(' ', 5) << " "
-            << output14Bit(rpnMsg_.value).paddedLeft(' ', 5) << std::endl;
+                         "nrpn           " << output14Bit(display.parameterNumber).paddedLeft(' ', 5) << " "
+            << output14Bit(display.parameterValue).paddedLeft(' ', 5) << std::endl;
         }
         else if (display.displayRpn)
         {
             std::cout << "channel "  << outputChannel(msg) << "   " <<
-                         "rpn            " << output14Bit(rpnMsg_.parameterNumber).paddedLeft(' ', 5) << " "
-            << output14Bit(rpnMsg_.value).paddedLeft(' ', 5) << std::endl;
+                         "rpn            " << output14Bit(display.parameterNumber).paddedLeft(' ', 5) << " "
+            << output14Bit(display.parameterValue).paddedLeft(' ', 5) << std::endl;
         }
     }
     else if (msg.isProgramChange())
@@ -508,13 +1372,9 @@ void ApplicationState::outputMessage(const MidiMessage& msg, DisplayState& displ
     }
     else if (msg.isSysEx())
     {
-        if (sysexOutput_.get() != nullptr)
+        if (sysexOutput_->isOpen())
         {
-            const uint8* data = msg.getRawData();
-            const int size = msg.getRawDataSize();
-            sysexOutput_->write(data, size);
-            sysexOutput_->flush();
-            std::cout << "system-exclusive-file " << size << " bytes" << std::endl;
+            std::cout << "system-exclusive-file " << msg.getRawDataSize() << " bytes" << std::endl;
         }
         else
         {
@@ -557,6 +1417,93 @@ void ApplicationState::outputMessage(const MidiMessage& msg, DisplayState& displ
     }
 }
 
+void ApplicationState::outputUniversalPacket(const ump::View& packet) const
+{
+    if (timestampOutput_)
+    {
+        Time t = Time::getCurrentTime();
+        std::cout << String(t.getHours()).paddedLeft('0', 2) << ":"
+        << String(t.getMinutes()).paddedLeft('0', 2) << ":"
+        << String(t.getSeconds()).paddedLeft('0', 2) << "."
+        << String(t.getMilliseconds()).paddedLeft('0', 3) << "   ";
+    }
+    
+    auto word = packet[0];
+    auto value = packet[1];
+    auto group = ump::Utils::getGroup(word);
+    auto channel = output7Bit(ump::Utils::getChannel(word) + 1).paddedLeft(' ', 2);
+    auto byte2 = (int)((word >> 8) & 0x7f);
+    auto byte3 = (int)(word & 0xff);
+    
+    if (group != 0)
+    {
+        std::cout << "group "  << output7Bit(group + 1).paddedLeft(' ', 2) << "   ";
+    }
+    std::cout << "channel "  << channel << "   ";
+    
+    switch (ump::Utils::getStatus(word))
+    {
+        case 0x8:
+        case 0x9:
+            std::cout << (ump::Utils::getStatus(word) == 0x9 ? "note-on         " : "note-off        ")
+            << outputNoteNumber(byte2) << " " << output16Bit(value >> 16).paddedLeft(' ', 5);
+            if (byte3 != 0)
+            {
+                std::cout << " attribute " << output7Bit(byte3) << " " << output16Bit(value & 0xffff);
+            }
+            break;
+        case 0xa:
+            std::cout << "poly-pressure   " << outputNoteNumber(byte2) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0xb:
+            std::cout << "control-change   " << output7Bit(byte2).paddedLeft(' ', 3) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0xc:
+            std::cout << "program-change   " << output7Bit((value >> 24) & 0x7f).paddedLeft(' ', 7);
+            if ((word & 0x1) != 0)
+            {
+                std::cout << " bank " << output14Bit((int)(((value >> 8) & 0x7f) << 7 | (value & 0x7f)));
+            }
+            break;
+        case 0xd:
+            std::cout << "channel-pressure " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0xe:
+            std::cout << "pitch-bend       " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0x0:
+            std::cout << "per-note-rpn    " << outputNoteNumber(byte2) << " " << output7Bit(byte3).paddedLeft(' ', 3) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0x1:
+            std::cout << "per-note-nrpn   " << outputNoteNumber(byte2) << " " << output7Bit(byte3).paddedLeft(' ', 3) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0x2:
+            std::cout << "rpn            " << output14Bit(byte2 << 7 | (byte3 & 0x7f)).paddedLeft(' ', 5) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0x3:
+            std::cout << "nrpn           " << output14Bit(byte2 << 7 | (byte3 & 0x7f)).paddedLeft(' ', 5) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0x4:
+            std::cout << "rpn-relative   " << output14Bit(byte2 << 7 | (byte3 & 0x7f)).paddedLeft(' ', 5) << " " << String((int32)value).paddedLeft(' ', 11);
+            break;
+        case 0x5:
+            std::cout << "nrpn-relative  " << output14Bit(byte2 << 7 | (byte3 & 0x7f)).paddedLeft(' ', 5) << " " << String((int32)value).paddedLeft(' ', 11);
+            break;
+        case 0x6:
+            std::cout << "per-note-pitch-bend " << outputNoteNumber(byte2) << " " << output32Bit(value).paddedLeft(' ', 10);
+            break;
+        case 0xf:
+            std::cout << "per-note-management " << outputNoteNumber(byte2)
+            << ((byte3 & 0x2) != 0 ? " detach" : "") << ((byte3 & 0x1) != 0 ? " reset" : "");
+            break;
+        default:
+            std::cout << "unknown-midi2    " << String::toHexString(word).paddedLeft('0', 8).toUpperCase();
+            break;
+    }
+    
+    std::cout << std::endl;
+}
+
 String ApplicationState::output7BitAsHex(int v) const
 {
     return String::toHexString(v).paddedLeft('0', 2).toUpperCase();
@@ -591,15 +1538,44 @@ String ApplicationState::output14Bit(int v) const
     }
 }
 
+String ApplicationState::output16Bit(uint32 v) const
+{
+    if (useHexadecimalsByDefault_)
+    {
+        return String::toHexString((int)v).paddedLeft('0', 4).toUpperCase();
+    }
+    else
+    {
+        return String(v);
+    }
+}
+
+String ApplicationState::output32Bit(uint32 v) const
+{
+    if (useHexadecimalsByDefault_)
+    {
+        return String::toHexString((int)v).paddedLeft('0', 8).toUpperCase();
+    }
+    else
+    {
+        return String(v);
+    }
+}
+
 String ApplicationState::outputNote(const MidiMessage& msg) const
+{
+    return outputNoteNumber(msg.getNoteNumber());
+}
+
+String ApplicationState::outputNoteNumber(int note) const
 {
     if (noteNumbersOutput_)
     {
-        return output7Bit(msg.getNoteNumber()).paddedLeft(' ', 4);
+        return output7Bit(note).paddedLeft(' ', 4);
     }
     else
     {
-        return MidiMessage::getMidiNoteName(msg.getNoteNumber(), true, true, octaveMiddleC_).paddedLeft(' ', 4);
+        return MidiMessage::getMidiNoteName(note, true, true, octaveMiddleC_).paddedLeft(' ', 4);
     }
 }
 
@@ -639,6 +1615,7 @@ bool ApplicationState::tryToConnectMidiInput()
     
     if (midi_input)
     {
+        setInputPortName(midi_input_name);
         midi_input->start();
         midiIn_.swap(midi_input);
         fullMidiInName_ = midi_input_name;
@@ -650,6 +1627,13 @@ bool ApplicationState::tryToConnectMidiInput()
 
 void ApplicationState::executeCommand(ApplicationCommand& cmd)
 {
+    if (running_ && !isLiveCommand(cmd.command_))
+    {
+        std::cerr << "Command \"" << cmd.param_ << "\" can't be changed while running" << std::endl;
+        commandFailed();
+        return;
+    }
+    
     switch (cmd.command_)
     {
         case NONE:
@@ -674,27 +1658,99 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
             {
                 name = cmd.opts_[0];
             }
+            rtpIn_ = nullptr;
             midiIn_ = MidiInput::createNewDevice(name, this);
             if (midiIn_ == nullptr)
             {
                 std::cerr << "Couldn't create virtual MIDI input port \"" << name << "\"" << std::endl;
-                JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+                commandFailed();
             }
             else
             {
                 midiInName_ = cmd.opts_[0];
                 fullMidiInName_.clear();
+                setInputPortName(name);
                 midiIn_->start();
             }
 #else
             std::cerr << "Virtual MIDI input ports are not supported on Windows" << std::endl;
-            JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+            commandFailed();
 #endif
             break;
         }
+        case RTP_MIDI:
+        {
+            midiIn_ = nullptr;
+            midiInName_.clear();
+            fullMidiInName_.clear();
+            
+            int port = asDecOrHexIntValue(cmd.opts_[0]);
+            setInputPortName("RTP-MIDI " + String(port));
+            rtpIn_ = std::make_unique<RtpMidiInput>(*this);
+            if (!rtpIn_->start(port, DEFAULT_VIRTUAL_NAME))
+            {
+                std::cerr << "Couldn't listen for RTP-MIDI on UDP ports " << port << " and " << (port + 1) << std::endl;
+                commandFailed();
+                rtpIn_ = nullptr;
+            }
+            else
+            {
+                std::cerr << "Waiting for RTP-MIDI sessions on UDP ports " << port << " and " << (port + 1) << std::endl;
+            }
+            break;
+        }
+        case CONTROL:
+            controlPort_ = cmd.opts_.isEmpty() ? 0 : asDecOrHexIntValue(cmd.opts_[0]);
+            break;
+        case UMP_FILE:
+            // the packets are only read once all the other commands are known
+            umpInPath_ = cmd.opts_[0];
+            break;
         case PASSTHROUGH:
         {
-            midiPass_ = openOutputDevice(cmd.opts_[0]);
+            // the scheduled messages are sent out before the port changes
+            passScheduler_->stop();
+            midiPass_ = BatchedMidiOutput::open(cmd.opts_[0]);
+            if (midiPass_ == nullptr)
+            {
+                // the output device already reported the problem
+                commandFailed();
+            }
+            else if (passDelay_ > 0.0)
+            {
+                passScheduler_->start(*midiPass_, passDelay_);
+            }
+            break;
+        }
+        case PASS_TRANSFORM:
+        {
+            String error;
+            if (!editLive(LiveConfiguration::TRANSFORM).transform_->parse(cmd.opts_[0], *this, error))
+            {
+                std::cerr << error << std::endl;
+                commandFailed();
+            }
+            break;
+        }
+        case PASS_DELAY:
+            passDelay_ = jmax(0.0, cmd.opts_[0].getDoubleValue());
+            passScheduler_->stop();
+            if (midiPass_ && passDelay_ > 0.0)
+            {
+                passScheduler_->start(*midiPass_, passDelay_);
+            }
+            break;
+        case ROUTE:
+        {
+            String error;
+            if (!editLive(LiveConfiguration::ROUTES).router_->addRoute(cmd.opts_[0], cmd.opts_[1], cmd.opts_[2], *this, error))
+            {
+                if (error.isNotEmpty())
+                {
+                    std::cerr << error << std::endl;
+                }
+                commandFailed();
+            }
             break;
         }
         case TXTFILE:
@@ -708,7 +1764,7 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
             else
             {
                 std::cerr << "Couldn't find file \"" << path << "\"" << std::endl;
-                JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+                commandFailed();
             }
             break;
         }
@@ -733,8 +1789,157 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
         case RAWDUMP:
             rawdump_ = true;
             break;
+        case JSON_LINES:
+            jsonOutput_ = true;
+            break;
+        case DASHBOARD:
+            // the dashboard is started once all the display options are known
+            dashboardRate_ = cmd.opts_.isEmpty() ? DEFAULT_DASHBOARD_RATE : asDecOrHexIntValue(cmd.opts_[0]);
+            quiet_ = true;
+            break;
+        case COALESCE:
+        {
+            int window = asDecOrHexIntValue(cmd.opts_[0]);
+            if (window > MessageCoalescer::MAX_WINDOW_MS)
+            {
+                std::cerr << "Coalesce window " << window << " is longer than " << MessageCoalescer::MAX_WINDOW_MS << " ms" << std::endl;
+                commandFailed();
+            }
+            else if (window > 0)
+            {
+                coalescer_->start(window);
+            }
+            else
+            {
+                coalescer_->stop();
+            }
+            break;
+        }
+        case STATISTICS:
+            statistics_->start(asDecOrHexIntValue(cmd.opts_[0]));
+            quiet_ = true;
+            break;
+        case METRICS:
+        {
+            String path(cmd.opts_[0]);
+            File file = File::getCurrentWorkingDirectory().getChildFile(path);
+            if (!metrics_->start(file, asDecOrHexIntValue(cmd.opts_[1])))
+            {
+                std::cerr << "Couldn't create directory for \"" << path << "\"" << std::endl;
+                commandFailed();
+            }
+            break;
+        }
+        case TRACE:
+        {
+            String path(cmd.opts_[0]);
+            File file = File::getCurrentWorkingDirectory().getChildFile(path);
+            if (!tracer_->start(file))
+            {
+                std::cerr << "Couldn't create directory for \"" << path << "\"" << std::endl;
+                commandFailed();
+            }
+            break;
+        }
+        case SINK:
+        {
+            MessageSink::OverflowPolicy policy;
+            if (!MessageSink::parsePolicy(cmd.opts_[2], policy))
+            {
+                std::cerr << "Unknown overflow policy \"" << cmd.opts_[2] << "\", use block, drop-oldest, drop-newest or coalesce" << std::endl;
+                commandFailed();
+                break;
+            }
+            
+            if (cmd.opts_[0].equalsIgnoreCase("text") && textSink_ != nullptr)
+            {
+                std::cerr << "Only one text sink can write to standard output" << std::endl;
+                commandFailed();
+                break;
+            }
+            
+            String error;
+            auto sink = MessageSink::create(cmd.opts_[0], cmd.opts_[1], policy, *this, error);
+            if (sink == nullptr)
+            {
+                if (error.isNotEmpty())
+                {
+                    std::cerr << error << std::endl;
+                }
+                commandFailed();
+            }
+            else
+            {
+                if (cmd.opts_[0].equalsIgnoreCase("text"))
+                {
+                    textSink_ = sink.get();
+                }
+                sinks_.add(sink.release());
+            }
+            break;
+        }
+        case SERVE:
+        {
+            StreamServer::Format format;
+            StreamServer::SlowClientPolicy policy;
+            String error;
+            if (!StreamServer::parseFormat(cmd.opts_[1], format))
+            {
+                std::cerr << "Unknown format \"" << cmd.opts_[1] << "\", use raw or text" << std::endl;
+                commandFailed();
+            }
+            else if (!StreamServer::parsePolicy(cmd.opts_[2], policy))
+            {
+                std::cerr << "Unknown slow client policy \"" << cmd.opts_[2] << "\", use disconnect or drop" << std::endl;
+                commandFailed();
+            }
+            else if (!server_->start(cmd.opts_[0], format, policy, error))
+            {
+                std::cerr << error << std::endl;
+                commandFailed();
+            }
+            break;
+        }
+        case SHARED_MEMORY:
+        {
+            String error;
+            if (!sharedMemory_->start(cmd.opts_[0], error))
+            {
+                std::cerr << error << std::endl;
+                commandFailed();
+            }
+            break;
+        }
+        case CSV_EXPORT:
+        {
+            String path(cmd.opts_[0]);
+            File file = File::getCurrentWorkingDirectory().getChildFile(path);
+            if (!csvExport_->open(file))
+            {
+                std::cerr << "Couldn't create file \"" << path << "\"" << std::endl;
+                commandFailed();
+            }
+            break;
+        }
+        case RECORDER:
+        {
+            String path(cmd.opts_[0]);
+            File file = File::getCurrentWorkingDirectory().getChildFile(path);
+            const int seconds = jmax(1, asDecOrHexIntValue(cmd.opts_[1]));
+            const size_t capacity = (size_t)jmax(1, asDecOrHexIntValue(cmd.opts_[2])) * 1024;
+            if (!recorder_->start(file, seconds, capacity))
+            {
+                std::cerr << "Couldn't create directory for \"" << path << "\"" << std::endl;
+                commandFailed();
+            }
+            else
+            {
+                quiet_ = true;
+            }
+            break;
+        }
         case JAVASCRIPT:
-            scriptCode_ = cmd.opts_[0];
+            editLive(LiveConfiguration::SCRIPT).scriptCode_ = cmd.opts_[0];
             break;
         case JAVASCRIPT_FILE:
         {
@@ -742,12 +1947,46 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
             File file = File::getCurrentWorkingDirectory().getChildFile(path);
             if (file.existsAsFile())
             {
-                scriptCode_ = file.loadFileAsString();
+                editLive(LiveConfiguration::SCRIPT).scriptCode_ = file.loadFileAsString();
             }
             else
             {
                 std::cerr << "Couldn't find file \"" << path << "\"" << std::endl;
-                JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+                commandFailed();
+            }
+            break;
+        }
+        case FILTER_EXPRESSION:
+        {
+            auto expression = std::make_shared<FilterExpression>();
+            String error;
+            if (!expression->compile(cmd.opts_[0], *this, error))
+            {
+                std::cerr << error << std::endl;
+                commandFailed();
+            }
+            else
+            {
+                ApplicationCommand filter = cmd;
+                filter.expression_ = expression;
+                editLive(LiveConfiguration::FILTERS).filters_.add(filter);
+            }
+            break;
+        }
+        case SYSEX_MATCH:
+        {
+            auto matcher = std::make_shared<SysexMatcher>();
+            String error;
+            if (!matcher->compile(cmd.opts_[0], error))
+            {
+                std::cerr << error << std::endl;
+                commandFailed();
+            }
+            else
+            {
+                ApplicationCommand filter = cmd;
+                filter.sysexMatcher_ = matcher;
+                editLive(LiveConfiguration::FILTERS).filters_.add(filter);
             }
             break;
         }
@@ -755,19 +1994,29 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
         {
             String path(cmd.opts_[0]);
             File file = File::getCurrentWorkingDirectory().getChildFile(path);
-            file.deleteFile();
-            sysexOutput_ = file.createOutputStream();
-            if (sysexOutput_.get() == nullptr)
+            if (!sysexOutput_->open(file))
             {
                 std::cerr << "Couldn't create file \"" << path << "\"" << std::endl;
-                JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+                commandFailed();
             }
             else
             {
-                filterCommands_.add(cmd);
+                editLive(LiveConfiguration::FILTERS).filters_.add(cmd);
             }
             break;
         }
+        case SYSEX_NUMBERED:
+            sysexOutput_->setSplitMessages(true);
+            break;
+        case SYSEX_ROTATE_SIZE:
+            sysexOutput_->setRotateSize((int64)jmax(0, asDecOrHexIntValue(cmd.opts_[0])) * 1024);
+            break;
+        case SYSEX_ROTATE_TIME:
+            sysexOutput_->setRotateTime(jmax(0, asDecOrHexIntValue(cmd.opts_[0])));
+            break;
+        case SYSEX_GZIP:
+            sysexOutput_->setCompress(true);
+            break;
         case MPE_PROFILE:
         {
 #if (JUCE_LINUX || JUCE_MAC)
@@ -776,7 +2025,7 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
             mpeProfile_->setProfileMidiName(cmd.opts_[0]);
 #else
             std::cerr << "MPE Profile responder with virtual MIDI ports is not supported on Windows" << std::endl;
-            JUCEApplicationBase::getInstance()->setApplicationReturnValue(EXIT_FAILURE);
+            commandFailed();
 #endif
             break;
         }
@@ -793,8 +2042,12 @@ void ApplicationState::executeCommand(ApplicationCommand& cmd)
             mpeProfile_->setSupportsThirdDimension(jlimit(0, 2, asDecOrHexIntValue(cmd.opts_[0])));
             break;
         default:
-            filterCommands_.add(cmd);
+        {
+            ApplicationCommand filter = cmd;
+            filter.compileMasks(*this);
+            editLive(LiveConfiguration::FILTERS).filters_.add(filter);
             break;
+        }
     }
 }
 
@@ -847,6 +2100,46 @@ uint16 ApplicationState::asDecOrHex14BitValue(String value) const
     return (uint16)limit14Bit(asDecOrHexIntValue(value));
 }
 
+BigInteger ApplicationState::asValueSet(const String& value, bool noteNames, int lowest, int highest) const
+{
+    BigInteger set;
+    
+    StringArray items;
+    items.addTokens(value, ",", "");
+    for (String item : items)
+    {
+        item = item.trim();
+        
+        // a dash separates the ends of a range, unless it's the sign of a note's octave
+        int separator = -1;
+        for (int i = 1; i < item.length() && separator < 0; ++i)
+        {
+            if (item[i] == '-')
+            {
+                String before = item.substring(0, i).toUpperCase();
+                bool isNoteName = noteNames && before.substring(0, 1).containsOnly("CDEFGABH") &&
+                                  (before.length() == 1 || (before.length() == 2 && before.substring(1).containsOnly("#B")));
+                if (!isNoteName)
+                {
+                    separator = i;
+                }
+            }
+        }
+        
+        String from = separator < 0 ? item : item.substring(0, separator);
+        String to = separator < 0 ? item : item.substring(separator + 1);
+        int first = jlimit(lowest, highest, noteNames ? (int)asNoteNumber(from) : asDecOrHexIntValue(from));
+        int last = jlimit(lowest, highest, noteNames ? (int)asNoteNumber(to) : asDecOrHexIntValue(to));
+        if (first > last)
+        {
+            std::swap(first, last);
+        }
+        set.setRange(first, last - first + 1, true);
+    }
+    
+    return set;
+}
+
 int ApplicationState::asDecOrHexIntValue(String value) const
 {
     if (value.endsWithIgnoreCase("H"))
@@ -857,7 +2150,7 @@ int ApplicationState::asDecOrHexIntValue(String value) const
     {
         return value.getIntValue();
     }
-    else if (useHexadecimalsByDefault_)
+    else if (parseHexadecimals_)
     {
         return value.getHexValue32();
     }
@@ -877,6 +2170,15 @@ uint16 ApplicationState::limit14Bit(int value)
     return (uint16)jlimit(0, 0x3fff, value);
 }
 
+uint8 ApplicationState::getStatusByte(const MidiMessage* msg, const uint32* packetWords)
+{
+    if (msg != nullptr)
+    {
+        return msg->getRawData()[0];
+    }
+    return (uint8)(packetWords[0] >> 16);
+}
+
 void ApplicationState::printVersion()
 {
     std::cout << ProjectInfo::projectName << " v" << ProjectInfo::versionString << std::endl;
@@ -910,28 +2212,25 @@ void ApplicationState::printUsage()
         }
         std::cout << std::endl;
         
-        if (cmd.optionsDescriptions_.size() > 1)
-        {
-            auto i = 1;
-            for (; i < cmd.optionsDescriptions_.size(); ++i)
-            {
-                auto line = cmd.optionsDescriptions_.getReference(i);
-                String param_option2;
-                param_option2 << "        " << line.paddedRight(' ', 9) << "  ";
-                param_option2 = param_option2.substring(0, 19);
-                std::cout << param_option2;
-                
-                if (i < cmd.commandDescriptions_.size())
-                {
-                    std::cout << cmd.commandDescriptions_.getReference(i);
-                }
-                
-                std::cout << std::endl;
-            }
-            for (; i < cmd.commandDescriptions_.size(); ++i)
+        auto i = 1;
+        for (; i < cmd.optionsDescriptions_.size(); ++i)
+        {
+            auto line = cmd.optionsDescriptions_.getReference(i);
+            String param_option2;
+            param_option2 << "        " << line.paddedRight(' ', 9) << "  ";
+            param_option2 = param_option2.substring(0, 19);
+            std::cout << param_option2;
+            
+            if (i < cmd.commandDescriptions_.size())
             {
-                std::cout << "                   " << cmd.commandDescriptions_.getReference(i) << std::endl;
+                std::cout << cmd.commandDescriptions_.getReference(i);
             }
+            
+            std::cout << std::endl;
+        }
+        for (; i < cmd.commandDescriptions_.size(); ++i)
+        {
+            std::cout << "                   " << cmd.commandDescriptions_.getReference(i) << std::endl;
         }
     }
     std::cout << "  -h  or  --help   Print Help (this message) and exit" << std::endl;
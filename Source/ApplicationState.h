@@ -21,10 +21,32 @@
 #include "JuceHeader.h"
 
 #include "ApplicationCommand.h"
+#include "BatchedMidiOutput.h"
+#include "CommandChannel.h"
+#include "ControllerDecoder.h"
+#include "CsvExport.h"
+#include "FilterExpression.h"
+#include "SysexMatcher.h"
+#include "DejitteredOutput.h"
+#include "FlightRecorder.h"
+#include "JsonLinesWriter.h"
+#include "LiveConfiguration.h"
+#include "MessageCoalescer.h"
+#include "MessageSink.h"
+#include "MessageStatistics.h"
+#include "MessageTracer.h"
+#include "Metrics.h"
+#include "MidiRouter.h"
 #include "MpeProfileNegotiation.h"
+#include "RtpMidiInput.h"
 #include "ScriptMidiMessageClass.h"
+#include "SharedMemoryPublisher.h"
+#include "StreamServer.h"
+#include "SysexFileOutput.h"
+#include "TerminalDashboard.h"
+#include "UmpFileInput.h"
 
-class ApplicationState : public MidiInputCallback, public Timer
+class ApplicationState : public MidiInputCallback, public ump::Receiver, public MessageCoalescer::Listener, public CommandChannel::Listener, public Metrics::Listener, public Timer
 {
 public:
     ApplicationState();
@@ -36,13 +58,13 @@ public:
     uint8 asNoteNumber(String value) const;
     uint8 asDecOrHex7BitValue(String value) const;
     uint16 asDecOrHex14BitValue(String value) const;
+    BigInteger asValueSet(const String& value, bool noteNames, int lowest, int highest) const;
     
     void outputMessage(const MidiMessage& msg, DisplayState& display) const;
-
-    MidiRPNDetector rpnDetector_;
-    MidiRPNMessage rpnMsg_;
-    
-    int lastCC_[16][128];
+    void outputReceivedMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display) const;
+    void triggerRecorder();
+    const ControllerState& getControllerState() const { return *controllerState_; }
+    const String& getInputPortName() const { return inputPortName_; }
 
 private:
     bool isMidiInDeviceAvailable(const String& name);
@@ -56,43 +78,103 @@ private:
     void parseParameters(StringArray& parameters);
     void parseFile(File file);
     void handleIncomingMidiMessage(MidiInput*, const MidiMessage& msg) override;
+    void handlePartialSysexMessage(MidiInput*, const uint8* data, int numBytesSoFar, double timestamp) override;
+    void packetReceived(const ump::View& packet, double time) override;
+    void processMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords);
+    void processFilteredMessage(const LiveConfiguration::Settings& live, const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display);
+    void coalescedMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display) override;
+    bool commandLineReceived(const String& line) override;
+    void collectQueues(Array<Metrics::Queue>& queues) override;
+    void commandFailed();
+    LiveConfiguration::Settings& editLive(int part);
+    static bool isLiveCommand(CommandIndex command);
+    void sendPassThrough(const MidiMessage& msg);
     void dumpMessage(const MidiMessage& msg) const;
+    void dumpUniversalPacket(const uint32* words, int numWords) const;
+    void outputUniversalPacket(const ump::View& packet) const;
+    int getDecoded14BitValue(const MidiMessage& msg, const DisplayState& display) const;
+    void outputJson(const MidiMessage& msg, DisplayState& display) const;
+    void outputJsonUniversalPacket(const ump::View& packet) const;
     String output7BitAsHex(int v) const;
     String output7Bit(int v) const;
     String output14BitAsHex(int v) const;
     String output14Bit(int v) const;
+    String output16Bit(uint32 v) const;
+    String output32Bit(uint32 v) const;
+    String outputNoteNumber(int note) const;
     String outputNote(const MidiMessage& msg) const;
     String outputChannel(const MidiMessage& msg) const;
     bool tryToConnectMidiInput();
+    void setInputPortName(const String& name);
     void executeCommand(ApplicationCommand& cmd);
     
     int asDecOrHexIntValue(String value) const;
     static uint8 limit7Bit(int value);
     static uint16 limit14Bit(int value);
+    static uint8 getStatusByte(const MidiMessage* msg, const uint32* packetWords);
     void printVersion();
     void printUsage();
 
     Array<ApplicationCommand> commands_;
-    Array<ApplicationCommand> filterCommands_;
     ApplicationCommand currentCommand_;
     JavascriptEngine scriptEngine_;
-    String scriptCode_;
     ScriptMidiMessageClass* scriptMidiMessage_;
     
     bool timestampOutput_;
     bool noteNumbersOutput_;
     int octaveMiddleC_;
     bool useHexadecimalsByDefault_;
+    bool parseHexadecimals_;
     bool quiet_;
     bool rawdump_;
+    bool jsonOutput_;
+    int dashboardRate_;
     
     String midiInName_;
     std::unique_ptr<MidiInput> midiIn_;
     String fullMidiInName_;
+    String inputPortName_;
+    
+    std::unique_ptr<RtpMidiInput> rtpIn_;
+    String umpInPath_;
+    std::unique_ptr<UmpFileInput> umpIn_;
+    MemoryBlock umpSysex_;
+    Array<uint32> umpSysexWords_;
     
-    std::unique_ptr<MidiOutput> midiPass_;
+    std::shared_ptr<BatchedMidiOutput> midiPass_;
+    std::unique_ptr<DejitteredOutput> passScheduler_;
+    double passDelay_;
+    OwnedArray<MessageSink> sinks_;
+    MessageSink* textSink_;
+    std::unique_ptr<StreamServer> server_;
+    std::unique_ptr<SharedMemoryPublisher> sharedMemory_;
+    std::unique_ptr<ControllerState> controllerState_;
+    std::unique_ptr<ControllerDecoder> controllerDecoder_;
     
     std::unique_ptr<MpeProfileNegotiation> mpeProfile_;
 
-    std::unique_ptr<FileOutputStream> sysexOutput_;
+    std::unique_ptr<SysexFileOutput> sysexOutput_;
+    
+    std::unique_ptr<FlightRecorder> recorder_;
+    
+    std::unique_ptr<JsonLinesWriter> jsonWriter_;
+    
+    std::unique_ptr<CsvExport> csvExport_;
+    
+    std::unique_ptr<MessageStatistics> statistics_;
+    
+    std::unique_ptr<TerminalDashboard> dashboard_;
+    std::unique_ptr<MessageCoalescer> coalescer_;
+    std::unique_ptr<Metrics> metrics_;
+    std::unique_ptr<MessageTracer> tracer_;
+    
+    // the filters, routes, transform and script are compiled into pending settings, and then
+    // installed for the receiving threads at once
+    std::unique_ptr<LiveConfiguration> live_;
+    std::unique_ptr<LiveConfiguration::Settings> pending_;
+    int replacedParts_;
+    bool lineFailed_;
+    bool running_;
+    int controlPort_;
+    std::unique_ptr<CommandChannel> commandChannel_;
 };
@@ -0,0 +1,113 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "BatchedMidiOutput.h"
+
+#include "ApplicationState.h"
+
+namespace
+{
+    struct PendingDrains
+    {
+        int depth_ { 0 };
+        std::vector<std::shared_ptr<BatchedMidiOutput>> outputs_;
+    };
+    
+    // the outputs are kept alive until they're drained, even if a route is replaced meanwhile
+    thread_local PendingDrains pendingDrains;
+}
+
+BatchedMidiOutput::Burst::Burst()
+{
+    pendingDrains.depth_ += 1;
+}
+
+BatchedMidiOutput::Burst::~Burst()
+{
+    pendingDrains.depth_ -= 1;
+    if (pendingDrains.depth_ > 0)
+    {
+        return;
+    }
+    
+    for (auto& output : pendingDrains.outputs_)
+    {
+        output->drain();
+    }
+    pendingDrains.outputs_.clear();
+}
+
+std::shared_ptr<BatchedMidiOutput> BatchedMidiOutput::open(const String& name)
+{
+    std::shared_ptr<BatchedMidiOutput> output(new BatchedMidiOutput());
+#if JUCE_ALSA
+    output->batched_ = AlsaBatchedOutput::open(name);
+    if (output->batched_ != nullptr)
+    {
+        return output;
+    }
+#endif
+    output->output_ = ApplicationState::openOutputDevice(name);
+    if (output->output_ == nullptr)
+    {
+        return nullptr;
+    }
+    return output;
+}
+
+BatchedMidiOutput::~BatchedMidiOutput()
+{
+    drain();
+}
+
+void BatchedMidiOutput::sendMessageNow(const MidiMessage& msg)
+{
+#if JUCE_ALSA
+    if (batched_ != nullptr)
+    {
+        {
+            const ScopedLock sl(lock_);
+            batched_->enqueue(msg);
+        }
+        
+        if (pendingDrains.depth_ == 0)
+        {
+            drain();
+        }
+        else if (std::find_if(pendingDrains.outputs_.begin(), pendingDrains.outputs_.end(),
+                              [this](const std::shared_ptr<BatchedMidiOutput>& output) { return output.get() == this; }) == pendingDrains.outputs_.end())
+        {
+            pendingDrains.outputs_.push_back(shared_from_this());
+        }
+        return;
+    }
+#endif
+    output_->sendMessageNow(msg);
+}
+
+void BatchedMidiOutput::drain()
+{
+#if JUCE_ALSA
+    if (batched_ != nullptr)
+    {
+        const ScopedLock sl(lock_);
+        batched_->drain();
+    }
+#endif
+}
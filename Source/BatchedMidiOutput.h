@@ -0,0 +1,66 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "AlsaBatchedOutput.h"
+
+/**
+ * An output port for the pass-through and the routes that can write a burst of messages to the
+ * sequencer together.
+ *
+ * While a Burst is open on a thread, the messages that this thread sends are only buffered, and
+ * every output they went to is drained once when the outermost Burst closes. Outside of a Burst
+ * every message is drained right away, which is the case for the callbacks of JUCE's MIDI inputs
+ * since they don't tell when the events of a wake-up have all been delivered. On other platforms than Linux, or when the port can't
+ * be found on the sequencer, the messages go through JUCE's MidiOutput as before.
+ */
+class BatchedMidiOutput : public std::enable_shared_from_this<BatchedMidiOutput>
+{
+public:
+    class Burst
+    {
+    public:
+        Burst();
+        ~Burst();
+
+        JUCE_DECLARE_NON_COPYABLE (Burst)
+    };
+
+    static std::shared_ptr<BatchedMidiOutput> open(const String& name);
+
+    ~BatchedMidiOutput();
+
+    void sendMessageNow(const MidiMessage& msg);
+
+private:
+    BatchedMidiOutput() = default;
+
+    void drain();
+
+    std::unique_ptr<MidiOutput> output_;
+#if JUCE_ALSA
+    CriticalSection lock_;
+    std::unique_ptr<AlsaBatchedOutput> batched_;
+#endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BatchedMidiOutput)
+};
@@ -0,0 +1,170 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CommandChannel.h"
+
+#if (JUCE_LINUX || JUCE_MAC)
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+CommandChannel::CommandChannel(Listener& listener) : Thread("CommandChannel"), listener_(listener)
+{
+}
+
+CommandChannel::~CommandChannel()
+{
+    stop();
+}
+
+bool CommandChannel::start(int port, String& error)
+{
+    stop();
+    
+    if (port > 0)
+    {
+        socket_ = std::make_unique<StreamingSocket>();
+        if (!socket_->createListener(port, "127.0.0.1"))
+        {
+            error = "Couldn't listen for commands on TCP port " + String(port);
+            socket_ = nullptr;
+            return false;
+        }
+    }
+    else
+    {
+#if !(JUCE_LINUX || JUCE_MAC)
+        error = "Reading commands from standard input while running is not supported on Windows, use a port";
+        return false;
+#endif
+    }
+    
+    startThread();
+    return true;
+}
+
+void CommandChannel::stop()
+{
+    stopThread(1000);
+    clients_.clear();
+    socket_ = nullptr;
+}
+
+void CommandChannel::run()
+{
+    while (!threadShouldExit())
+    {
+        if (socket_ == nullptr)
+        {
+            if (!readStandardInput())
+            {
+                return;
+            }
+        }
+        else
+        {
+            if (socket_->waitUntilReady(true, clients_.isEmpty() ? 100 : 10) > 0)
+            {
+                if (auto* connection = socket_->waitForNextConnection())
+                {
+                    auto* client = clients_.add(new Client());
+                    client->socket_.reset(connection);
+                }
+            }
+            readClients();
+        }
+    }
+}
+
+bool CommandChannel::readStandardInput()
+{
+#if (JUCE_LINUX || JUCE_MAC)
+    // polling with a timeout lets the thread stop, a blocking read on standard input can't
+    // be interrupted
+    pollfd fd = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&fd, 1, 100) <= 0)
+    {
+        return true;
+    }
+    
+    char buffer[4096];
+    const ssize_t size = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+    if (size <= 0)
+    {
+        // the remaining text is a last line without newline
+        if (!stdinPending_.isEmpty())
+        {
+            listener_.commandLineReceived(stdinPending_.toString());
+        }
+        return false;
+    }
+    
+    handleData(stdinPending_, buffer, (int)size, nullptr);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CommandChannel::readClients()
+{
+    for (int i = clients_.size(); --i >= 0;)
+    {
+        auto* client = clients_[i];
+        if (client->socket_->waitUntilReady(true, 0) == 0)
+        {
+            continue;
+        }
+        
+        char buffer[4096];
+        const int size = client->socket_->read(buffer, sizeof(buffer), false);
+        if (size <= 0)
+        {
+            clients_.remove(i);
+        }
+        else
+        {
+            handleData(client->pending_, buffer, size, client->socket_.get());
+        }
+    }
+}
+
+void CommandChannel::handleData(MemoryBlock& pending, const char* data, int size, StreamingSocket* socket)
+{
+    int start = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        if (data[i] != '\n')
+        {
+            continue;
+        }
+        
+        pending.append(data + start, (size_t)(i - start));
+        start = i + 1;
+        
+        const bool succeeded = listener_.commandLineReceived(pending.toString().trimEnd());
+        pending.reset();
+        
+        if (socket != nullptr)
+        {
+            const char* reply = succeeded ? "ok\n" : "error\n";
+            socket->write(reply, (int)strlen(reply));
+        }
+    }
+    pending.append(data + start, (size_t)(size - start));
+}
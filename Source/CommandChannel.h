@@ -0,0 +1,63 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Reads lines of commands while the application runs, either from standard input or from the
+ * clients of a TCP port on localhost, and hands each line to the listener on its own thread.
+ *
+ * The clients of the port get back a line with ok or error for each line of commands.
+ */
+class CommandChannel : public Thread
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual bool commandLineReceived(const String& line) = 0;
+    };
+
+    CommandChannel(Listener& listener);
+    ~CommandChannel() override;
+
+    bool start(int port, String& error);
+    void stop();
+
+private:
+    struct Client
+    {
+        std::unique_ptr<StreamingSocket> socket_;
+        MemoryBlock pending_;
+    };
+
+    void run() override;
+    bool readStandardInput();
+    void readClients();
+    void handleData(MemoryBlock& pending, const char* data, int size, StreamingSocket* socket);
+
+    Listener& listener_;
+    std::unique_ptr<StreamingSocket> socket_;
+    OwnedArray<Client> clients_;
+    MemoryBlock stdinPending_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CommandChannel)
+};
@@ -0,0 +1,82 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ControllerDecoder.h"
+
+ControllerDecoder::ControllerDecoder(ControllerState& state) : state_(state)
+{
+}
+
+void ControllerDecoder::decode(const MidiMessage& msg, DisplayState& display)
+{
+    if (!msg.isController())
+    {
+        return;
+    }
+
+    int ch = msg.getChannel() - 1;
+    int cc = msg.getControllerNumber();
+    int v = msg.getControllerValue();
+
+    if (cc < 64)
+    {
+        const int msb_cc = cc & 0x1f;
+        const ControllerState::Channel& values = state_.getChannel(ch);
+        
+        // handle 14-bit MIDI CC values as appropriate
+        if (cc < 32)
+        {
+            // only trigger an MSB-initiated change when its value is different than before
+            // if it's the same, wait for the LSB to trigger the change, a new MSB always
+            // starts with an LSB of 0
+            if (v != values.get(cc))
+            {
+                display.controlChange14bit = true;
+                display.controlChange14bitValue = v << 7;
+            }
+        }
+        // handle 14-bit MIDI CC LSB values
+        else if (values.isSet(msb_cc))
+        {
+            display.controlChange14bit = true;
+            display.controlChange14bitValue = (values.get(msb_cc) << 7) | v;
+        }
+        display.controlChange14bitNumber = msb_cc;
+    }
+    state_.set(ch, cc, v);
+    
+    auto rpn = rpnDetector_.tryParse(msg.getChannel(), cc, v);
+    if (rpn.has_value())
+    {
+        display.parameter = true;
+        display.parameterIsNrpn = rpn->isNRPN;
+        display.parameterIs14bit = rpn->is14BitValue;
+        display.parameterNumber = rpn->parameterNumber;
+        display.parameterValue = rpn->value;
+    }
+}
+
+void ControllerDecoder::decodeUniversalPacket(const uint32* words)
+{
+    // MIDI 2.0 controllers are kept at the 7-bit resolution of the controller state
+    const uint32 word = words[0];
+    if ((word >> 28) == 0x4 && ((word >> 20) & 0xf) == 0xb)
+    {
+        state_.set((int)((word >> 16) & 0xf), (int)((word >> 8) & 0x7f), (int)(words[1] >> 25));
+    }
+}
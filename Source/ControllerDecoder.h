@@ -0,0 +1,47 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "ControllerState.h"
+#include "DisplayState.h"
+
+/**
+ * Decodes 14-bit control changes and (N)RPN sequences from incoming MIDI 1.0 controller messages.
+ *
+ * Every controller message is decoded exactly once, before the filters, so that the cc14, nrpn
+ * and rpn filters, the script and the formatters all read the same result from the DisplayState
+ * instead of each feeding the message through its own copy of the parser. The last value of
+ * each controller is kept in the controller state of the current input port.
+ */
+class ControllerDecoder
+{
+public:
+    ControllerDecoder(ControllerState& state);
+
+    void decode(const MidiMessage& msg, DisplayState& display);
+    void decodeUniversalPacket(const uint32* words);
+
+private:
+    ControllerState& state_;
+    MidiRPNDetector rpnDetector_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControllerDecoder)
+};
@@ -0,0 +1,65 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ControllerState.h"
+
+ControllerState::Port::Port(const String& name) : name_(name)
+{
+    for (auto& channel : channels_)
+    {
+        for (auto& value : channel.values_)
+        {
+            value = 0;
+        }
+        channel.valid_[0] = 0;
+        channel.valid_[1] = 0;
+    }
+}
+
+ControllerState::ControllerState() : portRegistry_(PortRegistry::UNLIMITED)
+{
+    current_ = ports_.add(new Port(String()));
+}
+
+void ControllerState::setPort(const String& name)
+{
+    const ScopedLock sl(portLock_);
+    
+    const int index = portRegistry_.setPort(name);
+    if (index == ports_.size())
+    {
+        ports_.add(new Port(name));
+    }
+    ports_[index]->name_ = name;
+    current_ = ports_[index];
+}
+
+const ControllerState::Port* ControllerState::findPort(const String& name) const
+{
+    const ScopedLock sl(portLock_);
+    
+    for (auto* port : ports_)
+    {
+        if (port->name_ == name)
+        {
+            return port;
+        }
+    }
+    
+    return nullptr;
+}
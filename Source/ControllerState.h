@@ -0,0 +1,89 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PortRegistry.h"
+
+/**
+ * Compact store of the last received controller values, with one table for each input port.
+ *
+ * Each channel keeps a byte per controller number and a validity bitset, aligned to a cache
+ * line, so that a port only takes about 3 KB. The receiving thread writes the values of the
+ * current port with relaxed atomic stores, the script, the statistics and the dashboard read
+ * them in place. Ports are only added and looked up from the message thread.
+ */
+class ControllerState
+{
+public:
+    struct alignas(64) Channel
+    {
+        std::atomic<uint8> values_[128];
+        std::atomic<uint64> valid_[2];
+
+        bool isSet(int number) const
+        {
+            return (valid_[number >> 6].load(std::memory_order_relaxed) >> (number & 63)) & 1;
+        }
+
+        int get(int number) const
+        {
+            return isSet(number) ? values_[number].load(std::memory_order_relaxed) : -1;
+        }
+    };
+
+    struct Port
+    {
+        Port(const String& name);
+
+        String name_;
+        Channel channels_[16];
+    };
+
+    ControllerState();
+
+    void setPort(const String& name);
+    const Port* findPort(const String& name) const;
+
+    const Channel& getChannel(int channel) const { return current_.load(std::memory_order_relaxed)->channels_[channel]; }
+    int get(int channel, int number) const { return getChannel(channel).get(number); }
+
+    void set(int channel, int number, int value)
+    {
+        Channel& c = current_.load(std::memory_order_relaxed)->channels_[channel];
+        c.values_[number].store((uint8)value, std::memory_order_relaxed);
+
+        // the validity bit is only set once, which avoids a read-modify-write for each value
+        const uint64 bit = (uint64)1 << (number & 63);
+        std::atomic<uint64>& valid = c.valid_[number >> 6];
+        if ((valid.load(std::memory_order_relaxed) & bit) == 0)
+        {
+            valid.fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    CriticalSection portLock_;
+    PortRegistry portRegistry_;
+    OwnedArray<Port> ports_;
+    std::atomic<Port*> current_     { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ControllerState)
+};
@@ -0,0 +1,235 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CsvExport.h"
+
+CsvExport::CsvExport() : Thread("CSV Export")
+{
+    // timestamps are based on the high resolution counter, they're written as milliseconds
+    // since the epoch
+    timeOffset_ = (double)Time::currentTimeMillis() - Time::getMillisecondCounterHiRes();
+}
+
+CsvExport::~CsvExport()
+{
+    close();
+}
+
+bool CsvExport::open(const File& file)
+{
+    close();
+    
+    file.deleteFile();
+    output_ = file.createOutputStream(1 << 20);
+    if (output_ == nullptr)
+    {
+        return false;
+    }
+    
+    *output_ << "timestamp,port,status,channel,data1,data2,value\n";
+    rows_ = 0;
+    
+    {
+        const ScopedLock sl(lock_);
+        current_ = std::make_unique<RecordBatch>();
+        lastQueued_ = Time::getMillisecondCounter();
+    }
+    
+    startThread();
+    return true;
+}
+
+void CsvExport::close()
+{
+    if (!isThreadRunning())
+    {
+        return;
+    }
+    
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+    
+    {
+        const ScopedLock sl(lock_);
+        queueCurrentBatch();
+    }
+    writeQueuedBatches();
+    output_.reset();
+    
+    std::cerr << "Exported " << rows_ << " messages" << std::endl;
+}
+
+void CsvExport::setPort(const String& name)
+{
+    const ScopedLock sl(lock_);
+    port_ = ports_.indexOf(name);
+    if (port_ < 0)
+    {
+        port_ = ports_.size();
+        ports_.add(name);
+    }
+}
+
+void CsvExport::add(double timestamp, const uint8* data, int size, int value14Bit)
+{
+    if (!isOpen() || size <= 0)
+    {
+        return;
+    }
+    
+    bool full = false;
+    {
+        const ScopedLock sl(lock_);
+        RecordBatch& batch = *current_;
+        const int row = batch.size_++;
+        batch.timestamp_[row] = timestamp;
+        batch.port_[row] = port_;
+        batch.status_[row] = data[0];
+        // SysEx data isn't exported, only its status
+        batch.dataSize_[row] = (uint8)(data[0] == 0xf0 ? 0 : jmin(size - 1, 2));
+        batch.data1_[row] = batch.dataSize_[row] > 0 ? data[1] : 0;
+        batch.data2_[row] = batch.dataSize_[row] > 1 ? data[2] : 0;
+        batch.value_[row] = value14Bit;
+        
+        if (batch.size_ == BATCH_SIZE)
+        {
+            queueCurrentBatch();
+            full = true;
+        }
+    }
+    
+    if (full)
+    {
+        notify();
+    }
+}
+
+void CsvExport::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(1000);
+        
+        {
+            const ScopedLock sl(lock_);
+            if (Time::getMillisecondCounter() - lastQueued_ >= 1000)
+            {
+                queueCurrentBatch();
+            }
+        }
+        
+        writeQueuedBatches();
+    }
+}
+
+void CsvExport::queueCurrentBatch()
+{
+    lastQueued_ = Time::getMillisecondCounter();
+    if (current_ == nullptr || current_->size_ == 0)
+    {
+        return;
+    }
+    
+    queued_.add(current_.release());
+    if (free_.isEmpty())
+    {
+        current_ = std::make_unique<RecordBatch>();
+    }
+    else
+    {
+        current_.reset(free_.removeAndReturn(free_.size() - 1));
+    }
+}
+
+void CsvExport::writeQueuedBatches()
+{
+    for (;;)
+    {
+        RecordBatch* batch;
+        {
+            const ScopedLock sl(lock_);
+            if (queued_.isEmpty())
+            {
+                break;
+            }
+            batch = queued_.removeAndReturn(0);
+        }
+        
+        writeBatch(*batch);
+        
+        const ScopedLock sl(lock_);
+        batch->size_ = 0;
+        free_.add(batch);
+    }
+    
+    output_->flush();
+}
+
+void CsvExport::writeBatch(const RecordBatch& batch)
+{
+    StringArray ports;
+    {
+        const ScopedLock sl(lock_);
+        for (auto& port : ports_)
+        {
+            ports.add("\"" + port.replace("\"", "\"\"") + "\"");
+        }
+    }
+    
+    MemoryOutputStream text((size_t)batch.size_ * 48);
+    for (int row = 0; row < batch.size_; ++row)
+    {
+        const uint8 status = batch.status_[row];
+        const int64 micros = (int64)((batch.timestamp_[row] * 1000.0 + timeOffset_) * 1000.0 + 0.5);
+        text << String(micros / 1000) << "." << String(micros % 1000).paddedLeft('0', 3) << ",";
+        
+        if (batch.port_[row] >= 0)
+        {
+            text << ports[batch.port_[row]];
+        }
+        text << "," << (int)status << ",";
+        
+        if (status < 0xf0)
+        {
+            text << (status & 0xf) + 1;
+        }
+        text << ",";
+        
+        if (batch.dataSize_[row] > 0)
+        {
+            text << (int)batch.data1_[row];
+        }
+        text << ",";
+        
+        if (batch.dataSize_[row] > 1)
+        {
+            text << (int)batch.data2_[row];
+        }
+        text << ",";
+        
+        if (batch.value_[row] >= 0)
+        {
+            text << batch.value_[row];
+        }
+        text << "\n";
+    }
+    
+    output_->write(text.getData(), text.getDataSize());
+    rows_ += batch.size_;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Exports received MIDI messages to a CSV file for analysis.
+ *
+ * Messages are collected in columnar record batches, with a separate array for each column.
+ * Full batches, and every second also the batch that's being filled, are handed to a writer
+ * thread that formats them and appends them to the file, so the receiving thread never waits
+ * for the file.
+ */
+class CsvExport : public Thread
+{
+public:
+    CsvExport();
+    ~CsvExport() override;
+
+    bool open(const File& file);
+    void close();
+    bool isOpen() const { return isThreadRunning(); }
+
+    void setPort(const String& name);
+    void add(double timestamp, const uint8* data, int size, int value14Bit);
+
+private:
+    static constexpr int BATCH_SIZE = 4096;
+
+    struct RecordBatch
+    {
+        int size_ { 0 };
+        double timestamp_[BATCH_SIZE];
+        int port_[BATCH_SIZE];
+        uint8 status_[BATCH_SIZE];
+        uint8 data1_[BATCH_SIZE];
+        uint8 data2_[BATCH_SIZE];
+        uint8 dataSize_[BATCH_SIZE];
+        int value_[BATCH_SIZE];
+    };
+
+    void run() override;
+
+    void queueCurrentBatch();
+    void writeQueuedBatches();
+    void writeBatch(const RecordBatch& batch);
+
+    CriticalSection lock_;
+    OwnedArray<RecordBatch> free_;
+    OwnedArray<RecordBatch> queued_;
+    std::unique_ptr<RecordBatch> current_;
+    StringArray ports_;
+    int port_                       { -1 };
+    uint32 lastQueued_              { 0 };
+
+    std::unique_ptr<FileOutputStream> output_;
+    double timeOffset_              { 0.0 };
+    int64 rows_                     { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CsvExport)
+};
@@ -0,0 +1,215 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "DejitteredOutput.h"
+
+DejitteredOutput::DejitteredOutput() : Thread("DejitteredOutput"), queue_(CAPACITY), histogram_(HISTOGRAM_STEPS + 1, 0)
+{
+}
+
+DejitteredOutput::~DejitteredOutput()
+{
+    stop();
+}
+
+bool DejitteredOutput::isActive() const
+{
+    return output_ != nullptr;
+}
+
+void DejitteredOutput::start(BatchedMidiOutput& output, double delayMs)
+{
+    stop();
+    
+    output_ = &output;
+    delayMs_ = delayMs;
+    head_ = 0;
+    tail_ = 0;
+    sent_ = 0;
+    dropped_ = 0;
+    totalLatenessMs_ = 0.0;
+    maxLatenessMs_ = 0.0;
+    std::fill(histogram_.begin(), histogram_.end(), 0);
+    
+    // without the permissions for realtime scheduling, the highest regular priority is used
+    if (!startRealtimeThread(RealtimeOptions().withPriority(10)))
+    {
+        startThread(Priority::highest);
+    }
+}
+
+void DejitteredOutput::stop()
+{
+    if (!isActive())
+    {
+        return;
+    }
+    
+    // the messages that are still queued are sent out at their time
+    signalThreadShouldExit();
+    notify();
+    stopThread(roundToInt(delayMs_) + 1000);
+    
+    printReport();
+    output_ = nullptr;
+}
+
+int64 DejitteredOutput::getQueueDepth() const
+{
+    const ScopedLock sl(lock_);
+    return tail_ - head_;
+}
+
+int64 DejitteredOutput::getDropped() const
+{
+    const ScopedLock sl(lock_);
+    return dropped_;
+}
+
+void DejitteredOutput::push(const MidiMessage& msg)
+{
+    const double due = msg.getTimeStamp() * 1000.0 + delayMs_;
+    
+    {
+        // the receiving thread never waits for the output, a full queue drops the message
+        const ScopedLock sl(lock_);
+        if (tail_ - head_ == CAPACITY)
+        {
+            dropped_ += 1;
+            return;
+        }
+        
+        Entry& entry = queue_[(size_t)(tail_ % CAPACITY)];
+        entry.due_ = due;
+        entry.msg_ = msg;
+        tail_ += 1;
+    }
+    
+    notify();
+}
+
+void DejitteredOutput::run()
+{
+    for (;;)
+    {
+        bool available = false;
+        double due = 0.0;
+        {
+            const ScopedLock sl(lock_);
+            if (head_ < tail_)
+            {
+                available = true;
+                due = queue_[(size_t)(head_ % CAPACITY)].due_;
+            }
+        }
+        
+        if (!available)
+        {
+            if (threadShouldExit())
+            {
+                return;
+            }
+            wait(100);
+            continue;
+        }
+        
+        // the delay is constant, so the oldest message is always the first one that's due
+        const double remaining = due - Time::getMillisecondCounterHiRes();
+        if (remaining > SPIN_MS + 1.0)
+        {
+            wait((int)(remaining - SPIN_MS));
+            continue;
+        }
+        while (Time::getMillisecondCounterHiRes() < due)
+        {
+            Thread::yield();
+        }
+        
+        // only this thread consumes the queue, the entry can't change until head moves on
+        Entry& entry = queue_[(size_t)(head_ % CAPACITY)];
+        output_->sendMessageNow(entry.msg_);
+        
+        const double lateness = jmax(0.0, Time::getMillisecondCounterHiRes() - due);
+        histogram_[(size_t)jmin(HISTOGRAM_STEPS, (int)(lateness / HISTOGRAM_STEP_MS))] += 1;
+        sent_ += 1;
+        totalLatenessMs_ += lateness;
+        maxLatenessMs_ = jmax(maxLatenessMs_, lateness);
+        
+        {
+            const ScopedLock sl(lock_);
+            head_ += 1;
+        }
+    }
+}
+
+void DejitteredOutput::printReport() const
+{
+    std::cerr << "Pass-through with " << String(delayMs_, 1) << " ms delay sent " << sent_ << " messages";
+    if (dropped_ > 0)
+    {
+        std::cerr << ", dropped " << dropped_ << " messages that didn't fit in the queue";
+    }
+    if (sent_ == 0)
+    {
+        std::cerr << std::endl;
+        return;
+    }
+    
+    auto percentile = [this] (double fraction)
+    {
+        const int64 target = (int64)std::ceil(sent_ * fraction);
+        int64 count = 0;
+        for (int i = 0; i <= HISTOGRAM_STEPS; ++i)
+        {
+            count += histogram_[(size_t)i];
+            if (count >= target)
+            {
+                return (i + 1) * HISTOGRAM_STEP_MS;
+            }
+        }
+        return HISTOGRAM_STEPS * HISTOGRAM_STEP_MS;
+    };
+    
+    std::cerr << ", output jitter mean " << String(totalLatenessMs_ / sent_, 3)
+              << " ms, p50 < " << String(percentile(0.5), 2)
+              << " ms, p99 < " << String(percentile(0.99), 2)
+              << " ms, p99.9 < " << String(percentile(0.999), 2)
+              << " ms, max " << String(maxLatenessMs_, 3) << " ms" << std::endl;
+    
+    // the distribution in roughly logarithmic ranges
+    const double limits[] = { 0.05, 0.1, 0.25, 0.5, 1.0, 2.0, 5.0, 10.0 };
+    int step = 0;
+    for (size_t l = 0; l <= numElementsInArray(limits); ++l)
+    {
+        int64 count = 0;
+        const int end = l < numElementsInArray(limits) ? roundToInt(limits[l] / HISTOGRAM_STEP_MS) : HISTOGRAM_STEPS + 1;
+        for (; step < end; ++step)
+        {
+            count += histogram_[(size_t)step];
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+        
+        const String range = l < numElementsInArray(limits) ? "< " + String(limits[l], 2) + " ms" : ">= " + String(limits[l - 1], 2) + " ms";
+        const double share = 100.0 * count / sent_;
+        std::cerr << "  " << range.paddedRight(' ', 12) << String(count).paddedLeft(' ', 10) << " " << String(share, 2).paddedLeft(' ', 6) << "% "
+                  << String::repeatedString("#", roundToInt(share / 2.5)) << std::endl;
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "BatchedMidiOutput.h"
+
+/**
+ * Sends pass-through messages at a constant delay after they were received, instead of right
+ * away, so that the timing variations of the input and of the processing don't end up on the
+ * output.
+ *
+ * A realtime thread sleeps until shortly before a message is due and spins for the remainder.
+ * The difference between the scheduled and the actual time of each message is collected, and
+ * its distribution is reported when the output is stopped. The receiving thread never waits
+ * for the output, messages that don't fit in the queue are dropped and counted.
+ */
+class DejitteredOutput : public Thread
+{
+public:
+    DejitteredOutput();
+    ~DejitteredOutput() override;
+
+    void start(BatchedMidiOutput& output, double delayMs);
+    void stop();
+    bool isActive() const;
+
+    void push(const MidiMessage& msg);
+    int64 getQueueDepth() const;
+    int64 getDropped() const;
+
+private:
+    static constexpr int CAPACITY = 8192;
+
+    // the last part before a message is due is spun instead of slept, to not depend on wake-ups
+    static constexpr double SPIN_MS = 2.0;
+
+    // lateness is collected in steps of 10 microseconds, up to 100 ms
+    static constexpr int HISTOGRAM_STEPS = 10000;
+    static constexpr double HISTOGRAM_STEP_MS = 0.01;
+
+    struct Entry
+    {
+        double due_             { 0.0 };
+        MidiMessage msg_;
+    };
+
+    void run() override;
+    void printReport() const;
+
+    BatchedMidiOutput* output_  { nullptr };
+    double delayMs_             { 0.0 };
+
+    CriticalSection lock_;
+    std::vector<Entry> queue_;
+    int64 head_                 { 0 };
+    int64 tail_                 { 0 };
+    int64 dropped_              { 0 };
+
+    std::vector<int64> histogram_;
+    int64 sent_                 { 0 };
+    double totalLatenessMs_     { 0.0 };
+    double maxLatenessMs_       { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DejitteredOutput)
+};
@@ -21,9 +21,19 @@
 struct DisplayState
 {
     bool filtered { false };
-    int channel { 0 };
+    uint16 channels { 0xffff };
     bool displayControlChange { true };
     bool displayControlChange14bit { false };
     bool displayNrpn { false };
     bool displayRpn { false };
+
+    // controller state decoded once per message, before the filters run
+    bool controlChange14bit { false };
+    int controlChange14bitNumber { 0 };
+    int controlChange14bitValue { 0 };
+    bool parameter { false };
+    bool parameterIsNrpn { false };
+    bool parameterIs14bit { false };
+    int parameterNumber { 0 };
+    int parameterValue { 0 };
 };
@@ -0,0 +1,563 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FilterExpression.h"
+
+#include "ApplicationState.h"
+
+static const String OPERATOR_CHARACTERS = "=!<>&|";
+
+static StringArray tokenize(const String& source)
+{
+    StringArray tokens;
+    
+    auto p = source.getCharPointer();
+    while (!p.isEmpty())
+    {
+        const juce_wchar c = *p;
+        if (CharacterFunctions::isWhitespace(c))
+        {
+            ++p;
+        }
+        else if (c == '(' || c == ')')
+        {
+            tokens.add(String::charToString(c));
+            ++p;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            // quoted strings keep their opening quote to tell them apart from the other tokens
+            String token = String::charToString(c);
+            ++p;
+            while (!p.isEmpty() && *p != c)
+            {
+                token += *p;
+                ++p;
+            }
+            if (!p.isEmpty())
+            {
+                ++p;
+            }
+            tokens.add(token);
+        }
+        else if (OPERATOR_CHARACTERS.containsChar(c))
+        {
+            String token = String::charToString(c);
+            ++p;
+            if (!p.isEmpty() && OPERATOR_CHARACTERS.containsChar(*p))
+            {
+                token += *p;
+                ++p;
+            }
+            tokens.add(token);
+        }
+        else
+        {
+            String token;
+            while (!p.isEmpty() && !CharacterFunctions::isWhitespace(*p) &&
+                   *p != '(' && *p != ')' && *p != '"' && *p != '\'' && !OPERATOR_CHARACTERS.containsChar(*p))
+            {
+                token += *p;
+                ++p;
+            }
+            tokens.add(token);
+        }
+    }
+    
+    return tokens;
+}
+
+static bool isComparison(const String& token)
+{
+    return token == "=" || token == "==" || token == "!=" ||
+           token == "<" || token == "<=" || token == ">" || token == ">=";
+}
+
+static bool isKeyword(const String& token)
+{
+    return token.equalsIgnoreCase("and") || token.equalsIgnoreCase("or") || token.equalsIgnoreCase("not") ||
+           token == "&&" || token == "||" || token == "!" || token == "(" || token == ")";
+}
+
+static bool isString(const String& token)
+{
+    return token.startsWithChar('"') || token.startsWithChar('\'');
+}
+
+bool FilterExpression::compile(const String& source, const ApplicationState& state, String& error)
+{
+    program_.clear();
+    masks_.clear();
+    ports_.clear();
+    
+    state_ = &state;
+    tokens_ = tokenize(source);
+    position_ = 0;
+    depth_ = 0;
+    error_.clear();
+    
+    if (tokens_.isEmpty())
+    {
+        fail("it is empty");
+    }
+    else if (parseOr() && position_ < tokens_.size())
+    {
+        fail("unexpected \"" + tokens_[position_] + "\"");
+    }
+    
+    state_ = nullptr;
+    tokens_.clear();
+    
+    if (error_.isNotEmpty())
+    {
+        error = "Invalid filter expression \"" + source + "\", " + error_;
+        return false;
+    }
+    
+    return true;
+}
+
+bool FilterExpression::parseOr()
+{
+    if (!parseAnd())
+    {
+        return false;
+    }
+    
+    while (position_ < tokens_.size() && (tokens_[position_].equalsIgnoreCase("or") || tokens_[position_] == "||"))
+    {
+        position_ += 1;
+        if (!parseAnd())
+        {
+            return false;
+        }
+        emit(OR);
+    }
+    
+    return error_.isEmpty();
+}
+
+bool FilterExpression::parseAnd()
+{
+    if (!parseUnary())
+    {
+        return false;
+    }
+    
+    while (position_ < tokens_.size() && (tokens_[position_].equalsIgnoreCase("and") || tokens_[position_] == "&&"))
+    {
+        position_ += 1;
+        if (!parseUnary())
+        {
+            return false;
+        }
+        emit(AND);
+    }
+    
+    return error_.isEmpty();
+}
+
+bool FilterExpression::parseUnary()
+{
+    if (position_ < tokens_.size() && (tokens_[position_].equalsIgnoreCase("not") || tokens_[position_] == "!"))
+    {
+        position_ += 1;
+        if (!parseUnary())
+        {
+            return false;
+        }
+        emit(NOT);
+        return true;
+    }
+    
+    return parsePrimary();
+}
+
+bool FilterExpression::parsePrimary()
+{
+    if (position_ >= tokens_.size())
+    {
+        return fail("it ends too early");
+    }
+    
+    const String token = tokens_[position_++];
+    if (token == "(")
+    {
+        if (!parseOr())
+        {
+            return false;
+        }
+        if (position_ >= tokens_.size() || tokens_[position_] != ")")
+        {
+            return fail("a closing parenthesis is missing");
+        }
+        position_ += 1;
+        return true;
+    }
+    
+    if (isString(token) || isKeyword(token) || isComparison(token))
+    {
+        return fail("unexpected \"" + token + "\"");
+    }
+    
+    const String name = token.toLowerCase();
+    
+    // a field is compared when it's followed by a comparison or a value, otherwise a name that
+    // can also be a message type, like note or cc, selects that type
+    const int field = getFieldIndex(name);
+    const String next = position_ < tokens_.size() ? tokens_[position_] : String();
+    if (name == "port" || (field >= 0 && (isComparison(next) || (next.isNotEmpty() && !isKeyword(next)))))
+    {
+        return parseComparison((Field)field, name);
+    }
+    
+    const int kinds = getKindMask(name);
+    if (kinds < 0)
+    {
+        return fail(field >= 0 ? "\"" + token + "\" needs a value" : "unknown \"" + token + "\"");
+    }
+    
+    BigInteger values;
+    values.setBitRangeAsInt(0, NUM_KINDS, (uint32)kinds);
+    emitMask(KIND, values);
+    return true;
+}
+
+bool FilterExpression::parseComparison(Field field, const String& name)
+{
+    String comparison = "=";
+    if (position_ < tokens_.size() && isComparison(tokens_[position_]))
+    {
+        comparison = tokens_[position_++];
+    }
+    if (position_ >= tokens_.size() || isKeyword(tokens_[position_]) || isComparison(tokens_[position_]))
+    {
+        return fail("\"" + name + "\" needs a value");
+    }
+    String value = tokens_[position_++];
+    
+    if (name == "port")
+    {
+        if (comparison != "=" && comparison != "==" && comparison != "!=")
+        {
+            return fail("ports can only be compared with = or !=");
+        }
+        if (isString(value))
+        {
+            value = value.substring(1);
+        }
+        emit(PORT_IS, 0, ports_.size());
+        ports_.add(value);
+        if (comparison == "!=")
+        {
+            emit(NOT);
+        }
+        return true;
+    }
+    
+    if (isString(value))
+    {
+        return fail("\"" + name + "\" needs a number");
+    }
+    
+    const int lowest = field == CHANNEL ? 1 : 0;
+    const int highest = getFieldHighest(field);
+    BigInteger values = state_->asValueSet(value, field == NOTE, lowest, highest);
+    
+    if (comparison == "!=")
+    {
+        BigInteger excluded = values;
+        values.clear();
+        for (int v = lowest; v <= highest; ++v)
+        {
+            values.setBit(v, !excluded[v]);
+        }
+    }
+    else if (comparison != "=" && comparison != "==")
+    {
+        if (values.countNumberOfSetBits() != 1)
+        {
+            return fail("\"" + name + " " + comparison + "\" needs a single value");
+        }
+        
+        const int v = values.getHighestBit();
+        int first = lowest;
+        int last = highest;
+        if (comparison == "<")
+        {
+            last = v - 1;
+        }
+        else if (comparison == "<=")
+        {
+            last = v;
+        }
+        else if (comparison == ">")
+        {
+            first = v + 1;
+        }
+        else
+        {
+            first = v;
+        }
+        
+        values.clear();
+        if (first <= last)
+        {
+            values.setRange(first, last - first + 1, true);
+        }
+    }
+    
+    emitMask(field, values);
+    return true;
+}
+
+void FilterExpression::emit(Opcode opcode, int field, int operand)
+{
+    if (opcode == FIELD_IN || opcode == PORT_IS)
+    {
+        depth_ += 1;
+        if (depth_ > MAX_DEPTH)
+        {
+            fail("it is nested too deeply");
+        }
+    }
+    else if (opcode == AND || opcode == OR)
+    {
+        depth_ -= 1;
+    }
+    
+    program_.push_back({ opcode, (uint8)field, (uint16)operand });
+}
+
+void FilterExpression::emitMask(Field field, const BigInteger& values)
+{
+    const int offset = (int)masks_.size();
+    const int words = getFieldHighest(field) / 64 + 1;
+    for (int w = 0; w < words; ++w)
+    {
+        masks_.push_back((uint64)values.getBitRangeAsInt(w * 64, 32) |
+                         (uint64)values.getBitRangeAsInt(w * 64 + 32, 32) << 32);
+    }
+    
+    emit(FIELD_IN, field, offset);
+}
+
+bool FilterExpression::fail(const String& message)
+{
+    if (error_.isEmpty())
+    {
+        error_ = message;
+    }
+    return false;
+}
+
+int FilterExpression::getFieldIndex(const String& name)
+{
+    if (name == "ch" || name == "channel")                                      return CHANNEL;
+    if (name == "note")                                                         return NOTE;
+    if (name == "vel" || name == "velocity")                                    return VELOCITY;
+    if (name == "cc" || name == "control-change")                               return CONTROLLER;
+    if (name == "val" || name == "value")                                       return VALUE;
+    if (name == "pc" || name == "program-change" || name == "program")          return PROGRAM;
+    if (name == "pb" || name == "pitch-bend" || name == "bend")                 return BEND;
+    return -1;
+}
+
+int FilterExpression::getKindMask(const String& name)
+{
+    if (name == "on" || name == "note-on")                                      return 1 << NOTE_ON;
+    if (name == "off" || name == "note-off")                                    return 1 << NOTE_OFF;
+    if (name == "note")                                                         return 1 << NOTE_ON | 1 << NOTE_OFF;
+    if (name == "pp" || name == "poly-pressure")                                return 1 << POLY_PRESSURE;
+    if (name == "cc" || name == "control-change")                               return 1 << CONTROL_CHANGE;
+    if (name == "pc" || name == "program-change")                               return 1 << PROGRAM_CHANGE;
+    if (name == "cp" || name == "channel-pressure")                             return 1 << CHANNEL_PRESSURE;
+    if (name == "pb" || name == "pitch-bend")                                   return 1 << PITCH_BEND;
+    if (name == "voice")                                                        return (1 << SYSTEM_EXCLUSIVE) - 1;
+    if (name == "syx" || name == "system-exclusive")                            return 1 << SYSTEM_EXCLUSIVE;
+    if (name == "sc" || name == "system-common")                                return 1 << SYSTEM_COMMON;
+    if (name == "sr" || name == "system-realtime")                              return 1 << SYSTEM_REALTIME;
+    if (name == "sys")                                                          return (1 << NUM_KINDS) - (1 << SYSTEM_EXCLUSIVE);
+    return -1;
+}
+
+int FilterExpression::getFieldHighest(Field field)
+{
+    switch (field)
+    {
+        case KIND:
+            return NUM_KINDS - 1;
+        case CHANNEL:
+            return 16;
+        case BEND:
+            return 0x3fff;
+        default:
+            return 0x7f;
+    }
+}
+
+bool FilterExpression::matches(const MidiMessage& msg, const String& port) const
+{
+    int fields[NUM_FIELDS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+    
+    const uint8* data = msg.getRawData();
+    const uint8 status = data[0];
+    const int data1 = msg.getRawDataSize() > 1 ? data[1] & 0x7f : 0;
+    const int data2 = msg.getRawDataSize() > 2 ? data[2] & 0x7f : 0;
+    if (status < 0xf0)
+    {
+        fields[CHANNEL] = (status & 0xf) + 1;
+    }
+    
+    switch (status & 0xf0)
+    {
+        case 0x80:
+        case 0x90:
+            fields[KIND] = (status & 0xf0) == 0x90 && data2 != 0 ? NOTE_ON : NOTE_OFF;
+            fields[NOTE] = data1;
+            fields[VELOCITY] = data2;
+            fields[VALUE] = data2;
+            break;
+        case 0xa0:
+            fields[KIND] = POLY_PRESSURE;
+            fields[NOTE] = data1;
+            fields[VALUE] = data2;
+            break;
+        case 0xb0:
+            fields[KIND] = CONTROL_CHANGE;
+            fields[CONTROLLER] = data1;
+            fields[VALUE] = data2;
+            break;
+        case 0xc0:
+            fields[KIND] = PROGRAM_CHANGE;
+            fields[PROGRAM] = data1;
+            fields[VALUE] = data1;
+            break;
+        case 0xd0:
+            fields[KIND] = CHANNEL_PRESSURE;
+            fields[VALUE] = data1;
+            break;
+        case 0xe0:
+            fields[KIND] = PITCH_BEND;
+            fields[BEND] = data2 << 7 | data1;
+            fields[VALUE] = data2;
+            break;
+        default:
+            fields[KIND] = status == 0xf0 ? SYSTEM_EXCLUSIVE : (status >= 0xf8 ? SYSTEM_REALTIME : SYSTEM_COMMON);
+            break;
+    }
+    
+    return run(fields, port);
+}
+
+bool FilterExpression::matchesUniversalPacket(const uint32* words, const String& port) const
+{
+    int fields[NUM_FIELDS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+    
+    // MIDI 2.0 values are scaled down to the 7-bit and 14-bit resolutions of the fields
+    const uint32 word = words[0];
+    switch (word >> 28)
+    {
+        case 0x1:
+            fields[KIND] = ((word >> 16) & 0xff) >= 0xf8 ? SYSTEM_REALTIME : SYSTEM_COMMON;
+            break;
+        case 0x3:
+            fields[KIND] = SYSTEM_EXCLUSIVE;
+            break;
+        case 0x4:
+        {
+            const int index = (int)((word >> 8) & 0x7f);
+            const int value = (int)(words[1] >> 25);
+            fields[CHANNEL] = (int)((word >> 16) & 0xf) + 1;
+            switch ((word >> 20) & 0xf)
+            {
+                case 0x8:
+                case 0x9:
+                    fields[KIND] = ((word >> 20) & 0xf) == 0x9 ? NOTE_ON : NOTE_OFF;
+                    fields[NOTE] = index;
+                    fields[VELOCITY] = value;
+                    fields[VALUE] = value;
+                    break;
+                case 0xa:
+                    fields[KIND] = POLY_PRESSURE;
+                    fields[NOTE] = index;
+                    fields[VALUE] = value;
+                    break;
+                case 0xb:
+                    fields[KIND] = CONTROL_CHANGE;
+                    fields[CONTROLLER] = index;
+                    fields[VALUE] = value;
+                    break;
+                case 0xc:
+                    fields[KIND] = PROGRAM_CHANGE;
+                    fields[PROGRAM] = (int)((words[1] >> 24) & 0x7f);
+                    fields[VALUE] = fields[PROGRAM];
+                    break;
+                case 0xd:
+                    fields[KIND] = CHANNEL_PRESSURE;
+                    fields[VALUE] = value;
+                    break;
+                case 0xe:
+                    fields[KIND] = PITCH_BEND;
+                    fields[BEND] = (int)(words[1] >> 18);
+                    fields[VALUE] = value;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    
+    return run(fields, port);
+}
+
+bool FilterExpression::run(const int* fields, const String& port) const
+{
+    // each result is shifted in as the lowest bit, the operators combine the two lowest bits
+    uint64 stack = 0;
+    for (const auto& instruction : program_)
+    {
+        switch (instruction.opcode_)
+        {
+            case FIELD_IN:
+            {
+                const int v = fields[instruction.field_];
+                const uint64 bit = v >= 0 ? (masks_[(size_t)(instruction.operand_ + (v >> 6))] >> (v & 63)) & 1 : 0;
+                stack = stack << 1 | bit;
+                break;
+            }
+            case PORT_IS:
+                stack = stack << 1 | (port.containsIgnoreCase(ports_[instruction.operand_]) ? 1 : 0);
+                break;
+            case NOT:
+                stack ^= 1;
+                break;
+            case AND:
+                stack = (stack >> 1) & (stack | ~(uint64)1);
+                break;
+            case OR:
+                stack = (stack >> 1) | (stack & 1);
+                break;
+        }
+    }
+    
+    return (stack & 1) != 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+class ApplicationState;
+
+/**
+ * Filter that selects messages with a boolean expression over their type and fields, for
+ * instance "on and ch 2-4 and vel > 100 and not port Seaboard".
+ *
+ * The expression is compiled into a short postfix program once. Every comparison becomes a
+ * test of the field value in a bit mask, so ranges, lists and inequalities all cost a single
+ * bit test, and the intermediate results are kept as bits of one integer.
+ */
+class FilterExpression
+{
+public:
+    FilterExpression() = default;
+
+    bool compile(const String& source, const ApplicationState& state, String& error);
+
+    bool matches(const MidiMessage& msg, const String& port) const;
+    bool matchesUniversalPacket(const uint32* words, const String& port) const;
+
+private:
+    enum Field
+    {
+        KIND,
+        CHANNEL,
+        NOTE,
+        VELOCITY,
+        CONTROLLER,
+        VALUE,
+        PROGRAM,
+        BEND,
+        NUM_FIELDS
+    };
+
+    enum Kind
+    {
+        NOTE_ON,
+        NOTE_OFF,
+        POLY_PRESSURE,
+        CONTROL_CHANGE,
+        PROGRAM_CHANGE,
+        CHANNEL_PRESSURE,
+        PITCH_BEND,
+        SYSTEM_EXCLUSIVE,
+        SYSTEM_COMMON,
+        SYSTEM_REALTIME,
+        NUM_KINDS
+    };
+
+    enum Opcode : uint8
+    {
+        FIELD_IN,
+        PORT_IS,
+        NOT,
+        AND,
+        OR
+    };
+
+    struct Instruction
+    {
+        Opcode opcode_;
+        uint8 field_;
+        uint16 operand_;
+    };
+
+    // the bits of the intermediate results are kept in a single 64-bit integer
+    static constexpr int MAX_DEPTH = 64;
+
+    bool parseOr();
+    bool parseAnd();
+    bool parseUnary();
+    bool parsePrimary();
+    bool parseComparison(Field field, const String& name);
+    void emit(Opcode opcode, int field = 0, int operand = 0);
+    void emitMask(Field field, const BigInteger& values);
+    bool fail(const String& message);
+
+    static int getFieldIndex(const String& name);
+    static int getKindMask(const String& name);
+    static int getFieldHighest(Field field);
+
+    bool run(const int* fields, const String& port) const;
+
+    std::vector<Instruction> program_;
+    std::vector<uint64> masks_;
+    StringArray ports_;
+
+    // only used while compiling
+    const ApplicationState* state_      { nullptr };
+    StringArray tokens_;
+    int position_                       { 0 };
+    int depth_                          { 0 };
+    String error_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FilterExpression)
+};
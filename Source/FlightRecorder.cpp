@@ -0,0 +1,183 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FlightRecorder.h"
+
+#include "UserSignal.h"
+
+bool FlightRecorder::start(const File& file, int seconds, size_t capacity)
+{
+    if (!file.getParentDirectory().createDirectory())
+    {
+        return false;
+    }
+    
+    {
+        const ScopedLock sl(lock_);
+        ring_.allocate(capacity, true);
+        capacity_ = capacity;
+        oldest_ = 0;
+        used_ = 0;
+        window_ = seconds;
+        file_ = file;
+    }
+    
+    UserSignal::install();
+    
+    active_ = true;
+    return true;
+}
+
+void FlightRecorder::record(const uint8* data, int size, double timestamp)
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    const size_t needed = sizeof(RecordHeader) + (size_t)size;
+    
+    const ScopedLock sl(lock_);
+    
+    // messages that can never fit are not recorded
+    if (needed > capacity_)
+    {
+        return;
+    }
+    
+    while (used_ + needed > capacity_)
+    {
+        removeOldest();
+    }
+    
+    while (used_ > 0)
+    {
+        RecordHeader oldest;
+        read(oldest_, &oldest, sizeof(RecordHeader));
+        if (oldest.timestamp_ >= timestamp - window_)
+        {
+            break;
+        }
+        removeOldest();
+    }
+    
+    RecordHeader header { timestamp, (uint32)size };
+    const size_t position = (oldest_ + used_) % capacity_;
+    write(position, &header, sizeof(RecordHeader));
+    write((position + sizeof(RecordHeader)) % capacity_, data, (size_t)size);
+    used_ += needed;
+}
+
+void FlightRecorder::writePendingDump()
+{
+    if (UserSignal::receivedSince(signalsSeen_))
+    {
+        triggered_ = true;
+    }
+    
+    if (active_ && triggered_.exchange(false))
+    {
+        // a new dump would mostly repeat the previous one until the window has passed, so
+        // triggers are ignored until then, which also stops a matching stream from filling the disk
+        const double now = Time::getMillisecondCounterHiRes() * 0.001;
+        if (now >= holdOffUntil_)
+        {
+            holdOffUntil_ = now + window_;
+            writeDump();
+        }
+    }
+}
+
+void FlightRecorder::read(size_t position, void* dest, size_t size) const
+{
+    const size_t first = jmin(size, capacity_ - position);
+    memcpy(dest, ring_ + position, first);
+    memcpy(static_cast<uint8*>(dest) + first, ring_.get(), size - first);
+}
+
+void FlightRecorder::write(size_t position, const void* source, size_t size)
+{
+    const size_t first = jmin(size, capacity_ - position);
+    memcpy(ring_ + position, source, first);
+    memcpy(ring_.get(), static_cast<const uint8*>(source) + first, size - first);
+}
+
+void FlightRecorder::removeOldest()
+{
+    RecordHeader oldest;
+    read(oldest_, &oldest, sizeof(RecordHeader));
+    const size_t size = sizeof(RecordHeader) + oldest.size_;
+    oldest_ = (oldest_ + size) % capacity_;
+    used_ -= size;
+}
+
+void FlightRecorder::writeDump()
+{
+    // copy the ring as quickly as possible, the file is written without holding up the recording
+    HeapBlock<uint8> window;
+    size_t size;
+    double now = Time::getMillisecondCounterHiRes() * 0.001;
+    {
+        const ScopedLock sl(lock_);
+        size = used_;
+        window.allocate(jmax(size, (size_t)1), false);
+        read(oldest_, window.get(), size);
+    }
+    
+    MidiMessageSequence sequence;
+    double start = -1.0;
+    for (size_t position = 0; position < size;)
+    {
+        RecordHeader header;
+        memcpy(&header, window + position, sizeof(RecordHeader));
+        position += sizeof(RecordHeader);
+        
+        if (header.timestamp_ >= now - window_)
+        {
+            if (start < 0.0)
+            {
+                start = header.timestamp_;
+            }
+            
+            // with 25 frames of 40 ticks per second, each tick is a millisecond
+            sequence.addEvent(MidiMessage(window + position, (int)header.size_, (header.timestamp_ - start) * 1000.0));
+        }
+        position += header.size_;
+    }
+    
+    MidiFile midiFile;
+    midiFile.setSmpteTimeFormat(25, 40);
+    midiFile.addTrack(sequence);
+    
+    dumps_ += 1;
+    File file = getDumpFile(dumps_);
+    file.deleteFile();
+    std::unique_ptr<FileOutputStream> output = file.createOutputStream();
+    if (output == nullptr || !midiFile.writeTo(*output))
+    {
+        std::cerr << "Couldn't write file \"" << file.getFullPathName() << "\"" << std::endl;
+        return;
+    }
+    
+    std::cerr << "Recorded " << sequence.getNumEvents() << " messages into \"" << file.getFullPathName() << "\"" << std::endl;
+}
+
+File FlightRecorder::getDumpFile(int number) const
+{
+    return file_.getSiblingFile(file_.getFileNameWithoutExtension() + String::formatted("-%04d", number) + file_.getFileExtension());
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Keeps the most recently received MIDI messages in a preallocated ring buffer, limited both
+ * in time and in size.
+ *
+ * Recording only copies the message bytes with their timestamp into the ring. When the
+ * recorder is triggered, from any thread or through SIGUSR1, the window of messages is written
+ * to a new numbered Standard MIDI File the next time pending dumps are handled. Triggers are
+ * ignored for the length of the window after each dump.
+ */
+class FlightRecorder
+{
+public:
+    FlightRecorder() = default;
+
+    bool start(const File& file, int seconds, size_t capacity);
+    bool isActive() const { return active_; }
+
+    void record(const uint8* data, int size, double timestamp);
+    void trigger() { triggered_ = true; }
+    void writePendingDump();
+
+private:
+    struct RecordHeader
+    {
+        double timestamp_;
+        uint32 size_;
+    };
+
+    void read(size_t position, void* dest, size_t size) const;
+    void write(size_t position, const void* source, size_t size);
+    void removeOldest();
+    void writeDump();
+    File getDumpFile(int number) const;
+
+    std::atomic<bool> active_       { false };
+    std::atomic<bool> triggered_    { false };
+
+    CriticalSection lock_;
+    HeapBlock<uint8> ring_;
+    size_t capacity_                { 0 };
+    size_t oldest_                  { 0 };
+    size_t used_                    { 0 };
+    double window_                  { 0.0 };
+
+    File file_;
+    int dumps_                      { 0 };
+    double holdOffUntil_            { 0.0 };
+    uint32 signalsSeen_             { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FlightRecorder)
+};
@@ -0,0 +1,185 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JsonLinesWriter.h"
+
+struct Fragment
+{
+    const char* text_;
+    size_t length_;
+};
+
+#define JSON_KEY(name) { ",\"" name "\":", sizeof(",\"" name "\":") - 1 }
+
+static const Fragment KEYS[] =
+{
+    JSON_KEY("group"),
+    JSON_KEY("channel"),
+    JSON_KEY("note"),
+    JSON_KEY("velocity"),
+    JSON_KEY("number"),
+    JSON_KEY("value"),
+    JSON_KEY("program"),
+    JSON_KEY("bank"),
+    JSON_KEY("index"),
+    JSON_KEY("attributeType"),
+    JSON_KEY("attributeValue"),
+    JSON_KEY("sequence"),
+    JSON_KEY("size"),
+    JSON_KEY("detach"),
+    JSON_KEY("reset"),
+    JSON_KEY("data"),
+    JSON_KEY("words")
+};
+
+#undef JSON_KEY
+
+static const Fragment TIMESTAMP = { ",\"timestamp\":", 13 };
+
+// the longest key and number that can be appended at once
+static constexpr size_t MAX_FIELD_SIZE = 64;
+
+JsonLinesWriter::JsonLinesWriter()
+{
+    ensure(4096);
+    
+    // message timestamps are based on the high resolution counter, they're written as
+    // milliseconds since the epoch
+    timeOffset_ = (double)Time::currentTimeMillis() - Time::getMillisecondCounterHiRes();
+}
+
+void JsonLinesWriter::setPort(const String& name)
+{
+    port_ = ",\"port\":" + JSON::toString(name).toStdString();
+}
+
+void JsonLinesWriter::add(Key key, int64 value)
+{
+    ensure(MAX_FIELD_SIZE);
+    appendKey(key);
+    appendNumber(value);
+}
+
+void JsonLinesWriter::addFlag(Key key, bool value)
+{
+    ensure(MAX_FIELD_SIZE);
+    appendKey(key);
+    if (value)
+    {
+        append("true", 4);
+    }
+    else
+    {
+        append("false", 5);
+    }
+}
+
+void JsonLinesWriter::add(Key key, const uint8* data, int size)
+{
+    // each byte takes at most three digits and a separator
+    ensure(MAX_FIELD_SIZE + (size_t)size * 4);
+    appendKey(key);
+    append("[", 1);
+    for (int i = 0; i < size; ++i)
+    {
+        if (i != 0)
+        {
+            append(",", 1);
+        }
+        appendNumber(data[i]);
+    }
+    append("]", 1);
+}
+
+void JsonLinesWriter::add(Key key, const uint32* words, int numWords)
+{
+    ensure(MAX_FIELD_SIZE + (size_t)numWords * 11);
+    appendKey(key);
+    append("[", 1);
+    for (int i = 0; i < numWords; ++i)
+    {
+        if (i != 0)
+        {
+            append(",", 1);
+        }
+        appendNumber(words[i]);
+    }
+    append("]", 1);
+}
+
+void JsonLinesWriter::end(double timestamp)
+{
+    ensure(MAX_FIELD_SIZE + port_.size());
+    
+    // milliseconds with microsecond precision
+    const int64 micros = (int64)((timestamp * 1000.0 + timeOffset_) * 1000.0 + 0.5);
+    append(TIMESTAMP.text_, TIMESTAMP.length_);
+    appendNumber(micros / 1000);
+    const int fraction = (int)(micros % 1000);
+    char decimals[4] = { '.', (char)('0' + fraction / 100), (char)('0' + fraction / 10 % 10), (char)('0' + fraction % 10) };
+    append(decimals, 4);
+    
+    append(port_.data(), port_.size());
+    append("}\n", 2);
+    
+    std::cout.write(buffer_.get(), (std::streamsize)length_);
+    std::cout.flush();
+    length_ = 0;
+}
+
+void JsonLinesWriter::ensure(size_t size)
+{
+    if (length_ + size > capacity_)
+    {
+        capacity_ = jmax(length_ + size, capacity_ * 2);
+        buffer_.realloc(capacity_);
+    }
+}
+
+void JsonLinesWriter::append(const char* text, size_t length)
+{
+    memcpy(buffer_ + length_, text, length);
+    length_ += length;
+}
+
+void JsonLinesWriter::appendKey(Key key)
+{
+    append(KEYS[key].text_, KEYS[key].length_);
+}
+
+void JsonLinesWriter::appendNumber(int64 value)
+{
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    
+    uint64 magnitude = value < 0 ? 0 - (uint64)value : (uint64)value;
+    do
+    {
+        *--start = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    while (magnitude != 0);
+    
+    if (value < 0)
+    {
+        *--start = '-';
+    }
+    
+    append(start, (size_t)(end - start));
+}
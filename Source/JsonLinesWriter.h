@@ -0,0 +1,87 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Writes one JSON object per line to standard output.
+ *
+ * Messages are serialized into a buffer that is reused for each message and that only grows
+ * when a message is larger than any before it. Keys and message types are written from
+ * precomputed fragments and numbers are formatted by hand, so no allocations happen for the
+ * individual messages.
+ */
+class JsonLinesWriter
+{
+public:
+    enum Key
+    {
+        GROUP,
+        CHANNEL,
+        NOTE,
+        VELOCITY,
+        NUMBER,
+        VALUE,
+        PROGRAM,
+        BANK,
+        INDEX,
+        ATTRIBUTE_TYPE,
+        ATTRIBUTE_VALUE,
+        SEQUENCE,
+        SIZE,
+        DETACH,
+        RESET,
+        DATA,
+        WORDS
+    };
+
+    JsonLinesWriter();
+
+    void setPort(const String& name);
+
+    template <size_t N>
+    void begin(const char (&type)[N])
+    {
+        ensure(N + 16);
+        append("{\"type\":\"", 9);
+        append(type, N - 1);
+        append("\"", 1);
+    }
+
+    void add(Key key, int64 value);
+    void addFlag(Key key, bool value);
+    void add(Key key, const uint8* data, int size);
+    void add(Key key, const uint32* words, int numWords);
+    void end(double timestamp);
+
+private:
+    void ensure(size_t size);
+    void append(const char* text, size_t length);
+    void appendKey(Key key);
+    void appendNumber(int64 value);
+
+    HeapBlock<char> buffer_;
+    size_t capacity_        { 0 };
+    size_t length_          { 0 };
+    std::string port_;
+    double timeOffset_      { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (JsonLinesWriter)
+};
@@ -0,0 +1,96 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LiveConfiguration.h"
+
+void LiveConfiguration::Settings::reset(int parts)
+{
+    if (parts & FILTERS)
+    {
+        // the SysEx file can't be changed while running, so its filter keeps capturing SysEx
+        // when the other filters are replaced
+        filters_.removeIf([](const ApplicationCommand& cmd) { return cmd.command_ != SYSTEM_EXCLUSIVE_FILE; });
+    }
+    if (parts & ROUTES)
+    {
+        router_ = std::make_shared<MidiRouter>();
+    }
+    if (parts & TRANSFORM)
+    {
+        transform_ = std::make_shared<MessageTransform>();
+    }
+    if (parts & SCRIPT)
+    {
+        scriptCode_.clear();
+    }
+}
+
+LiveConfiguration::Reader::Reader(const LiveConfiguration& configuration) :
+    readers_(configuration.readers_[configuration.epoch_.load() & 1])
+{
+    // the counter is raised before the pointer is read, so an install either waits for this
+    // reader or this reader already sees the new settings
+    readers_.fetch_add(1);
+    settings_ = configuration.current_.load();
+}
+
+LiveConfiguration::Reader::~Reader()
+{
+    readers_.fetch_sub(1);
+}
+
+LiveConfiguration::LiveConfiguration() : current_(createEmpty().release())
+{
+    readers_[0] = 0;
+    readers_[1] = 0;
+}
+
+LiveConfiguration::~LiveConfiguration()
+{
+    delete current_.load();
+}
+
+std::unique_ptr<LiveConfiguration::Settings> LiveConfiguration::createEmpty()
+{
+    auto settings = std::make_unique<Settings>();
+    settings->reset(ALL_PARTS);
+    return settings;
+}
+
+std::unique_ptr<LiveConfiguration::Settings> LiveConfiguration::createCopy() const
+{
+    // only the installing thread changes the pointer, so it can read the settings directly
+    return std::make_unique<Settings>(*current_.load());
+}
+
+void LiveConfiguration::install(std::unique_ptr<Settings> settings)
+{
+    std::unique_ptr<Settings> previous(current_.exchange(settings.release()));
+    
+    // flipping the epoch twice waits for the readers that started before the swap, also the
+    // ones that read the epoch before a previous install, while new readers use the other
+    // counter and can't hold up the wait
+    for (int i = 0; i < 2; ++i)
+    {
+        const int parity = epoch_.fetch_add(1) & 1;
+        while (readers_[parity].load() != 0)
+        {
+            Thread::sleep(1);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "ApplicationCommand.h"
+#include "MessageTransform.h"
+#include "MidiRouter.h"
+
+/**
+ * Holds the filters, routes, pass-through transform and script, which can be replaced while
+ * messages are received.
+ *
+ * New settings are compiled on the thread that parses the commands and installed by swapping an
+ * atomic pointer, read-copy-update style. The threads that receive messages never wait, they
+ * count themselves in one of two reader counters while they use the settings. The previous
+ * settings are deleted once the readers that might still see them have finished.
+ */
+class LiveConfiguration
+{
+public:
+    enum Part
+    {
+        FILTERS     = 1 << 0,
+        ROUTES      = 1 << 1,
+        TRANSFORM   = 1 << 2,
+        SCRIPT      = 1 << 3,
+        ALL_PARTS   = FILTERS | ROUTES | TRANSFORM | SCRIPT
+    };
+
+    struct Settings
+    {
+        void reset(int parts);
+
+        Array<ApplicationCommand> filters_;
+        std::shared_ptr<MidiRouter> router_;
+        std::shared_ptr<MessageTransform> transform_;
+        String scriptCode_;
+    };
+
+    // keeps the current settings alive while one message is processed
+    class Reader
+    {
+    public:
+        Reader(const LiveConfiguration& configuration);
+        ~Reader();
+
+        const Settings& operator*() const   { return *settings_; }
+        const Settings* operator->() const  { return settings_; }
+
+    private:
+        std::atomic<int>& readers_;
+        const Settings* settings_;
+
+        JUCE_DECLARE_NON_COPYABLE (Reader)
+    };
+
+    LiveConfiguration();
+    ~LiveConfiguration();
+
+    static std::unique_ptr<Settings> createEmpty();
+    std::unique_ptr<Settings> createCopy() const;
+    void install(std::unique_ptr<Settings> settings);
+
+private:
+    std::atomic<Settings*> current_;
+    std::atomic<int> epoch_             { 0 };
+    mutable std::atomic<int> readers_[2];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveConfiguration)
+};
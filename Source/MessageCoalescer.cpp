@@ -0,0 +1,321 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessageCoalescer.h"
+
+#include "BatchedMidiOutput.h"
+
+MessageCoalescer::Port::Port(const String& name) : name_(name)
+{
+    for (auto& key : keys_)
+    {
+        key = NONE;
+    }
+    for (auto& n : pending_)
+    {
+        n = 0;
+    }
+}
+
+MessageCoalescer::MessageCoalescer(Listener& listener) : Thread("receivemidi coalesce"), listener_(listener), portRegistry_(PortRegistry::UNLIMITED)
+{
+    port_ = ports_.add(new Port(String()));
+}
+
+MessageCoalescer::~MessageCoalescer()
+{
+    stop();
+}
+
+void MessageCoalescer::start(int windowMs)
+{
+    stop();
+    
+    {
+        const ScopedLock sl(lock_);
+        
+        windowMs_ = (uint32)jlimit(1, MAX_WINDOW_MS, windowMs);
+        pool_.resize(POOL_SIZE);
+        for (int i = 0; i < POOL_SIZE; ++i)
+        {
+            pool_[(size_t)i].next_ = i + 1 < POOL_SIZE ? (uint16)(i + 1) : NONE;
+        }
+        free_ = 0;
+        for (int i = 0; i < WHEEL_SLOTS; ++i)
+        {
+            heads_[i] = NONE;
+            tails_[i] = NONE;
+        }
+        pending_ = 0;
+        received_ = 0;
+        suppressed_ = 0;
+        active_ = true;
+    }
+    
+    startThread();
+}
+
+void MessageCoalescer::stop()
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    signalThreadShouldExit();
+    notify();
+    stopThread(1000);
+    
+    {
+        // the values that are still pending are sent out right away
+        const ScopedLock sl(lock_);
+        flushAll();
+        active_ = false;
+    }
+    
+    printReport();
+}
+
+void MessageCoalescer::getQueueState(int64& depth, int64& suppressed) const
+{
+    const ScopedLock sl(lock_);
+    depth = pending_;
+    suppressed = suppressed_;
+}
+
+void MessageCoalescer::setPort(const String& name)
+{
+    const ScopedLock sl(lock_);
+    
+    const int index = portRegistry_.setPort(name);
+    if (index == ports_.size())
+    {
+        ports_.add(new Port(name));
+    }
+    ports_[index]->name_ = name;
+    port_ = ports_[index];
+}
+
+void MessageCoalescer::process(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display)
+{
+    const ScopedLock sl(lock_);
+    
+    if (active_ && msg != nullptr)
+    {
+        const uint8 status = msg->getRawData()[0];
+        const int key = MessageSink::getCoalesceKey(*msg);
+        if (key >= 0)
+        {
+            received_ += 1;
+            
+            uint16 index = port_->keys_[key];
+            if (index != NONE)
+            {
+                suppressed_ += 1;
+            }
+            else if (free_ != NONE)
+            {
+                // the first value of a key opens its window
+                const uint32 now = Time::getMillisecondCounter();
+                if (pending_ == 0)
+                {
+                    tick_ = now;
+                }
+                
+                // the thread only needs to be woken up when it waits for the first value
+                if (idle_)
+                {
+                    idle_ = false;
+                    notify();
+                }
+                
+                index = free_;
+                Entry& entry = pool_[index];
+                free_ = entry.next_;
+                entry.port_ = port_;
+                entry.key_ = key;
+                entry.channel_ = status & 0xf;
+                entry.due_ = now + windowMs_;
+                link(index);
+                
+                port_->keys_[key] = index;
+                port_->pending_[entry.channel_] += 1;
+                pending_ += 1;
+            }
+            
+            if (index != NONE)
+            {
+                Entry& entry = pool_[index];
+                entry.msg_ = *msg;
+                entry.display_ = display;
+                entry.numPacketWords_ = packetWords != nullptr ? jmin(2, numPacketWords) : 0;
+                for (int i = 0; i < entry.numPacketWords_; ++i)
+                {
+                    entry.packet_[i] = packetWords[i];
+                }
+                return;
+            }
+            
+            // when all entries are in use, the message is passed on right away
+        }
+        
+        if (status < 0xf0)
+        {
+            flushChannel(port_, status & 0xf);
+        }
+        else
+        {
+            flushAll();
+        }
+    }
+    else if (active_)
+    {
+        flushAll();
+    }
+    
+    listener_.coalescedMessage(msg, packetWords, numPacketWords, display);
+}
+
+void MessageCoalescer::run()
+{
+    while (!threadShouldExit())
+    {
+        int timeout = -1;
+        {
+            // the messages that expire together are written to the outputs together, after
+            // the lock has been released
+            BatchedMidiOutput::Burst burst;
+            const ScopedLock sl(lock_);
+            
+            const uint32 now = Time::getMillisecondCounter();
+            while (pending_ > 0 && (int32)(now - tick_) > 0)
+            {
+                tick_ += 1;
+                uint16 index = heads_[tick_ & (WHEEL_SLOTS - 1)];
+                while (index != NONE)
+                {
+                    const uint16 next = pool_[index].next_;
+                    if ((int32)(pool_[index].due_ - tick_) <= 0)
+                    {
+                        emit(index);
+                    }
+                    index = next;
+                }
+            }
+            
+            if (pending_ > 0)
+            {
+                timeout = 1;
+            }
+            idle_ = (timeout < 0);
+        }
+        
+        wait(timeout);
+    }
+}
+
+void MessageCoalescer::link(uint16 index)
+{
+    Entry& entry = pool_[index];
+    const int slot = (int)(entry.due_ & (WHEEL_SLOTS - 1));
+    entry.prev_ = tails_[slot];
+    entry.next_ = NONE;
+    if (tails_[slot] != NONE)
+    {
+        pool_[tails_[slot]].next_ = index;
+    }
+    else
+    {
+        heads_[slot] = index;
+    }
+    tails_[slot] = index;
+}
+
+void MessageCoalescer::unlink(uint16 index)
+{
+    Entry& entry = pool_[index];
+    const int slot = (int)(entry.due_ & (WHEEL_SLOTS - 1));
+    if (entry.prev_ != NONE)
+    {
+        pool_[entry.prev_].next_ = entry.next_;
+    }
+    else
+    {
+        heads_[slot] = entry.next_;
+    }
+    if (entry.next_ != NONE)
+    {
+        pool_[entry.next_].prev_ = entry.prev_;
+    }
+    else
+    {
+        tails_[slot] = entry.prev_;
+    }
+}
+
+void MessageCoalescer::emit(uint16 index)
+{
+    Entry& entry = pool_[index];
+    unlink(index);
+    entry.port_->keys_[entry.key_] = NONE;
+    entry.port_->pending_[entry.channel_] -= 1;
+    pending_ -= 1;
+    
+    listener_.coalescedMessage(&entry.msg_, entry.numPacketWords_ > 0 ? entry.packet_ : nullptr, entry.numPacketWords_, entry.display_);
+    
+    entry.next_ = free_;
+    free_ = index;
+}
+
+void MessageCoalescer::flushChannel(Port* port, int channel)
+{
+    // the wheel is walked from the next tick onwards, in the order the windows were opened
+    for (uint32 t = tick_ + 1; port->pending_[channel] > 0 && t != tick_ + 1 + WHEEL_SLOTS; ++t)
+    {
+        uint16 index = heads_[t & (WHEEL_SLOTS - 1)];
+        while (index != NONE)
+        {
+            const uint16 next = pool_[index].next_;
+            if (pool_[index].port_ == port && pool_[index].channel_ == channel)
+            {
+                emit(index);
+            }
+            index = next;
+        }
+    }
+}
+
+void MessageCoalescer::flushAll()
+{
+    for (uint32 t = tick_ + 1; pending_ > 0 && t != tick_ + 1 + WHEEL_SLOTS; ++t)
+    {
+        uint16 index = heads_[t & (WHEEL_SLOTS - 1)];
+        while (index != NONE)
+        {
+            const uint16 next = pool_[index].next_;
+            emit(index);
+            index = next;
+        }
+    }
+}
+
+void MessageCoalescer::printReport() const
+{
+    std::cerr << "Coalescing within " << (int)windowMs_ << " ms windows received " << received_
+              << " controller messages and suppressed " << suppressed_ << std::endl;
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "DisplayState.h"
+#include "MessageSink.h"
+#include "PortRegistry.h"
+
+/**
+ * Limits the rate of controller, pitch bend and pressure messages by only keeping the latest
+ * value of each port, channel, type and number within a window of a number of milliseconds.
+ *
+ * The first value of a key opens its window, later values in the same window replace it. A
+ * thread advances a timer wheel with a slot per millisecond and hands the values of the slots
+ * that are due to the listener. Any other message first flushes the pending values of its
+ * channel, or of all channels for system messages, so that notes never overtake the
+ * controllers that were received before them.
+ */
+class MessageCoalescer : public Thread
+{
+public:
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual void coalescedMessage(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display) = 0;
+    };
+
+    static constexpr int MAX_WINDOW_MS = 1000;
+
+    MessageCoalescer(Listener& listener);
+    ~MessageCoalescer() override;
+
+    void start(int windowMs);
+    void stop();
+    bool isActive() const { return active_; }
+    void getQueueState(int64& depth, int64& suppressed) const;
+
+    void setPort(const String& name);
+    void process(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, DisplayState& display);
+
+private:
+    static constexpr int WHEEL_SLOTS = 1024;
+    static constexpr int POOL_SIZE = 4096;
+    static constexpr uint16 NONE = 0xffff;
+
+    struct Port
+    {
+        Port(const String& name);
+
+        String name_;
+        uint16 keys_[MessageSink::NUM_KEYS];
+        int pending_[16];
+    };
+
+    struct Entry
+    {
+        MidiMessage msg_;
+        uint32 packet_[2];
+        int numPacketWords_     { 0 };
+        DisplayState display_;
+        Port* port_             { nullptr };
+        int key_                { 0 };
+        int channel_            { 0 };
+        uint32 due_             { 0 };
+        uint16 prev_            { NONE };
+        uint16 next_            { NONE };
+    };
+
+    void run() override;
+
+    void link(uint16 index);
+    void unlink(uint16 index);
+    void emit(uint16 index);
+    void flushChannel(Port* port, int channel);
+    void flushAll();
+    void printReport() const;
+
+    Listener& listener_;
+    std::atomic<bool> active_   { false };
+    uint32 windowMs_            { 0 };
+
+    CriticalSection lock_;
+    PortRegistry portRegistry_;
+    OwnedArray<Port> ports_;
+    Port* port_                 { nullptr };
+    std::vector<Entry> pool_;
+    uint16 free_                { NONE };
+    uint16 heads_[WHEEL_SLOTS];
+    uint16 tails_[WHEEL_SLOTS];
+    uint32 tick_                { 0 };
+    int pending_                { 0 };
+    bool idle_                  { false };
+
+    int64 received_             { 0 };
+    int64 suppressed_           { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageCoalescer)
+};
@@ -0,0 +1,516 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessageSink.h"
+
+#include "AlsaBatchedOutput.h"
+#include "ApplicationState.h"
+
+class TextSink : public MessageSink
+{
+public:
+    TextSink(const ApplicationState& state, OverflowPolicy policy) : MessageSink("text -", policy), state_(state)
+    {
+    }
+    
+    ~TextSink() override
+    {
+        close();
+    }
+    
+protected:
+    void send(const MidiMessage& msg, const DisplayState& display) override
+    {
+        sendReceived(&msg, nullptr, 0, display);
+    }
+    
+    void sendReceived(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, const DisplayState& display) override
+    {
+        DisplayState copy = display;
+        state_.outputReceivedMessage(msg, packetWords, numPacketWords, copy);
+    }
+    
+private:
+    const ApplicationState& state_;
+};
+
+class RawSink : public MessageSink
+{
+public:
+    RawSink(const String& path, OverflowPolicy policy) : MessageSink("raw " + path, policy), standardOutput_(path == "-")
+    {
+        if (!standardOutput_)
+        {
+            File file = File::getCurrentWorkingDirectory().getChildFile(path);
+            file.deleteFile();
+            output_ = file.createOutputStream(1 << 16);
+        }
+    }
+    
+    ~RawSink() override
+    {
+        close();
+    }
+    
+    bool isValid() const
+    {
+        return output_ != nullptr || standardOutput_;
+    }
+    
+protected:
+    void send(const MidiMessage& msg, const DisplayState&) override
+    {
+        if (output_ != nullptr)
+        {
+            output_->write(msg.getRawData(), (size_t)msg.getRawDataSize());
+        }
+        else
+        {
+            std::cout.write((const char*)msg.getRawData(), msg.getRawDataSize());
+        }
+    }
+    
+    void flush() override
+    {
+        if (output_ != nullptr)
+        {
+            output_->flush();
+        }
+        else
+        {
+            std::cout << std::flush;
+        }
+    }
+    
+private:
+    const bool standardOutput_;
+    std::unique_ptr<FileOutputStream> output_;
+};
+
+class PassThroughSink : public MessageSink
+{
+public:
+    PassThroughSink(const String& port, OverflowPolicy policy) : MessageSink("port " + port, policy), port_(port)
+    {
+#if JUCE_ALSA
+        // each batch of queued messages is written to the sequencer at once
+        batchedOutput_ = AlsaBatchedOutput::open(port);
+        if (batchedOutput_ != nullptr)
+        {
+            return;
+        }
+#endif
+        output_ = ApplicationState::openOutputDevice(port);
+    }
+    
+    ~PassThroughSink() override
+    {
+        close();
+        
+#if JUCE_ALSA
+        if (batchedOutput_ != nullptr)
+        {
+            std::cerr << "Sink \"port " << port_ << "\" sent " << batchedOutput_->getNumMessages() << " messages in "
+                      << batchedOutput_->getNumDrains() << " sequencer writes" << std::endl;
+        }
+#endif
+    }
+    
+    bool isValid() const
+    {
+#if JUCE_ALSA
+        if (batchedOutput_ != nullptr)
+        {
+            return true;
+        }
+#endif
+        return output_ != nullptr;
+    }
+    
+protected:
+    void send(const MidiMessage& msg, const DisplayState&) override
+    {
+#if JUCE_ALSA
+        if (batchedOutput_ != nullptr)
+        {
+            batchedOutput_->enqueue(msg);
+            return;
+        }
+#endif
+        output_->sendMessageNow(msg);
+    }
+    
+    void flush() override
+    {
+#if JUCE_ALSA
+        if (batchedOutput_ != nullptr)
+        {
+            batchedOutput_->drain();
+        }
+#endif
+    }
+    
+private:
+    const String port_;
+    std::unique_ptr<MidiOutput> output_;
+#if JUCE_ALSA
+    std::unique_ptr<AlsaBatchedOutput> batchedOutput_;
+#endif
+};
+
+class UdpSink : public MessageSink
+{
+public:
+    UdpSink(const String& host, int port, OverflowPolicy policy) : MessageSink("udp " + host + ":" + String(port), policy), host_(host), port_(port)
+    {
+    }
+    
+    ~UdpSink() override
+    {
+        close();
+    }
+    
+protected:
+    void send(const MidiMessage& msg, const DisplayState&) override
+    {
+        socket_.write(host_, port_, msg.getRawData(), msg.getRawDataSize());
+    }
+    
+private:
+    const String host_;
+    const int port_;
+    DatagramSocket socket_;
+};
+
+class OscSink : public MessageSink
+{
+public:
+    OscSink(const String& host, int port, OverflowPolicy policy) : MessageSink("osc " + host + ":" + String(port), policy)
+    {
+        connected_ = sender_.connect(host, port);
+    }
+    
+    ~OscSink() override
+    {
+        close();
+    }
+    
+    bool isValid() const
+    {
+        return connected_;
+    }
+    
+protected:
+    void send(const MidiMessage& msg, const DisplayState&) override
+    {
+        // each byte of the MIDI message becomes an integer argument
+        OSCMessage osc("/midi");
+        const uint8* data = msg.getRawData();
+        for (int i = 0; i < msg.getRawDataSize(); ++i)
+        {
+            osc.addInt32(data[i]);
+        }
+        sender_.send(osc);
+    }
+    
+private:
+    OSCSender sender_;
+    bool connected_ { false };
+};
+
+static bool parseHostAndPort(const String& target, String& host, int& port)
+{
+    host = target.upToLastOccurrenceOf(":", false, false);
+    port = target.fromLastOccurrenceOf(":", false, false).getIntValue();
+    return host.isNotEmpty() && port > 0 && port < 65536;
+}
+
+std::unique_ptr<MessageSink> MessageSink::create(const String& type, const String& target, OverflowPolicy policy, const ApplicationState& state, String& error)
+{
+    std::unique_ptr<MessageSink> sink;
+    
+    if (type.equalsIgnoreCase("text"))
+    {
+        if (target != "-")
+        {
+            error = "Text sinks write to standard output, use - as target";
+            return nullptr;
+        }
+        sink = std::make_unique<TextSink>(state, policy);
+    }
+    else if (type.equalsIgnoreCase("raw"))
+    {
+        auto dump = std::make_unique<RawSink>(target, policy);
+        if (!dump->isValid())
+        {
+            error = "Couldn't create file \"" + target + "\"";
+            return nullptr;
+        }
+        sink = std::move(dump);
+    }
+    else if (type.equalsIgnoreCase("port"))
+    {
+        auto pass = std::make_unique<PassThroughSink>(target, policy);
+        if (!pass->isValid())
+        {
+            // the output device already reported the problem
+            return nullptr;
+        }
+        sink = std::move(pass);
+    }
+    else if (type.equalsIgnoreCase("udp") || type.equalsIgnoreCase("osc"))
+    {
+        String host;
+        int port;
+        if (!parseHostAndPort(target, host, port))
+        {
+            error = "Invalid host:port \"" + target + "\"";
+            return nullptr;
+        }
+        
+        if (type.equalsIgnoreCase("udp"))
+        {
+            sink = std::make_unique<UdpSink>(host, port, policy);
+        }
+        else
+        {
+            auto osc = std::make_unique<OscSink>(host, port, policy);
+            if (!osc->isValid())
+            {
+                error = "Couldn't connect OSC to \"" + target + "\"";
+                return nullptr;
+            }
+            sink = std::move(osc);
+        }
+    }
+    else
+    {
+        error = "Unknown sink type \"" + type + "\", use text, raw, port, udp or osc";
+        return nullptr;
+    }
+    
+    sink->startThread();
+    return sink;
+}
+
+bool MessageSink::parsePolicy(const String& name, OverflowPolicy& policy)
+{
+    if (name.equalsIgnoreCase("block"))
+    {
+        policy = BLOCK;
+    }
+    else if (name.equalsIgnoreCase("drop-oldest"))
+    {
+        policy = DROP_OLDEST;
+    }
+    else if (name.equalsIgnoreCase("drop-newest"))
+    {
+        policy = DROP_NEWEST;
+    }
+    else if (name.equalsIgnoreCase("coalesce"))
+    {
+        policy = COALESCE;
+    }
+    else
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+MessageSink::MessageSink(const String& name, OverflowPolicy policy) : Thread(name), name_(name), policy_(policy)
+{
+    queue_.resize(CAPACITY);
+    queuedKeys_.resize(NUM_KEYS, -1);
+}
+
+MessageSink::~MessageSink()
+{
+    // derived sinks close before their own members are destroyed
+    jassert(!isThreadRunning());
+}
+
+void MessageSink::getQueueState(int64& depth, int64& dropped, int64& coalesced) const
+{
+    const ScopedLock sl(lock_);
+    depth = tail_ - head_;
+    dropped = dropped_;
+    coalesced = coalesced_;
+}
+
+void MessageSink::sendReceived(const MidiMessage* msg, const uint32*, int, const DisplayState& display)
+{
+    if (msg != nullptr)
+    {
+        send(*msg, display);
+    }
+}
+
+void MessageSink::store(Entry& entry, const MidiMessage* msg, const uint32* packetWords, int numPacketWords, const DisplayState& display)
+{
+    // the entries are reused, so that the packet words don't allocate once the queue is warm
+    entry.hasMessage_ = (msg != nullptr);
+    entry.msg_ = msg != nullptr ? *msg : MidiMessage();
+    entry.display_ = display;
+    entry.packetWords_.clearQuick();
+    if (packetWords != nullptr)
+    {
+        entry.packetWords_.addArray(packetWords, numPacketWords);
+    }
+}
+
+void MessageSink::push(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, const DisplayState& display)
+{
+    const int key = (policy_ == COALESCE && msg != nullptr) ? getCoalesceKey(*msg) : -1;
+    
+    for (;;)
+    {
+        {
+            const ScopedLock sl(lock_);
+            
+            // a newer value replaces the queued one that the sink didn't get to yet
+            if (key >= 0 && queuedKeys_[key] >= head_)
+            {
+                store(queue_[(size_t)(queuedKeys_[key] % CAPACITY)], msg, packetWords, numPacketWords, display);
+                coalesced_ += 1;
+                return;
+            }
+            
+            if (tail_ - head_ == CAPACITY)
+            {
+                if (policy_ == DROP_NEWEST)
+                {
+                    dropped_ += 1;
+                    return;
+                }
+                else if (policy_ == DROP_OLDEST || policy_ == COALESCE)
+                {
+                    head_ += 1;
+                    dropped_ += 1;
+                }
+            }
+            
+            if (tail_ - head_ < CAPACITY)
+            {
+                if (key >= 0)
+                {
+                    queuedKeys_[key] = tail_;
+                }
+                store(queue_[(size_t)(tail_ % CAPACITY)], msg, packetWords, numPacketWords, display);
+                tail_ += 1;
+                break;
+            }
+        }
+        
+        // only the blocking policy gets here, waiting until the sink has caught up
+        notify();
+        if (!isThreadRunning())
+        {
+            return;
+        }
+        dequeued_.wait(10);
+    }
+    
+    notify();
+}
+
+void MessageSink::close()
+{
+    if (!isThreadRunning())
+    {
+        return;
+    }
+    
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+    
+    if (dropped_ > 0 || coalesced_ > 0)
+    {
+        std::cerr << "Sink \"" << name_ << "\" dropped " << dropped_ << " and coalesced " << coalesced_ << " messages" << std::endl;
+    }
+}
+
+void MessageSink::run()
+{
+    // the entries are swapped with the queue rather than copied, both keep their storage
+    std::vector<Entry> batch(CAPACITY);
+    
+    // the remaining messages are still sent out when the sink is closed
+    bool exiting = false;
+    while (!exiting)
+    {
+        exiting = threadShouldExit();
+        
+        size_t count = 0;
+        {
+            const ScopedLock sl(lock_);
+            while (head_ < tail_)
+            {
+                std::swap(batch[count++], queue_[(size_t)(head_ % CAPACITY)]);
+                head_ += 1;
+            }
+        }
+        dequeued_.signal();
+        
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Entry& entry = batch[i];
+            sendReceived(entry.hasMessage_ ? &entry.msg_ : nullptr,
+                         entry.packetWords_.isEmpty() ? nullptr : entry.packetWords_.getRawDataPointer(),
+                         entry.packetWords_.size(), entry.display_);
+        }
+        
+        if (count > 0)
+        {
+            flush();
+        }
+        else if (!exiting)
+        {
+            wait(100);
+        }
+    }
+}
+
+int MessageSink::getCoalesceKey(const MidiMessage& msg)
+{
+    const uint8* data = msg.getRawData();
+    const int channel = data[0] & 0xf;
+    switch (data[0] & 0xf0)
+    {
+        case 0xa0:
+            return channel << 7 | (data[1] & 0x7f);
+        case 0xb0:
+        {
+            // the controllers that make up RPN and NRPN messages have to be kept in sequence
+            const int cc = data[1] & 0x7f;
+            if (cc == 6 || cc == 38 || (cc >= 96 && cc <= 101))
+            {
+                return -1;
+            }
+            return 16 * 128 + (channel << 7 | cc);
+        }
+        case 0xd0:
+            return 16 * 128 * 2 + channel;
+        case 0xe0:
+            return 16 * 128 * 2 + 16 + channel;
+        default:
+            return -1;
+    }
+}
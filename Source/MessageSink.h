@@ -0,0 +1,97 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "DisplayState.h"
+
+class ApplicationState;
+
+/**
+ * A destination for received MIDI messages with its own bounded queue and worker thread.
+ *
+ * The receiving thread only pushes messages into the queue, the worker thread sends them out,
+ * so that a slow sink doesn't hold up the other outputs. When the queue is full, the overflow
+ * policy decides whether the receiving thread waits, the oldest or the newest message is
+ * dropped, or whether controller-like messages replace their queued predecessor.
+ */
+class MessageSink : public Thread
+{
+public:
+    enum OverflowPolicy
+    {
+        BLOCK,
+        DROP_OLDEST,
+        DROP_NEWEST,
+        COALESCE
+    };
+
+    static std::unique_ptr<MessageSink> create(const String& type, const String& target, OverflowPolicy policy, const ApplicationState& state, String& error);
+    static bool parsePolicy(const String& name, OverflowPolicy& policy);
+
+    // keys of the messages that can be coalesced, controllers and poly pressure per note,
+    // pitch bend and channel pressure per channel
+    static constexpr int NUM_KEYS = 16 * 128 * 2 + 16 * 2;
+    static int getCoalesceKey(const MidiMessage& msg);
+
+    ~MessageSink() override;
+
+    void push(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, const DisplayState& display);
+    void close();
+    void getQueueState(int64& depth, int64& dropped, int64& coalesced) const;
+
+protected:
+    MessageSink(const String& name, OverflowPolicy policy);
+
+    virtual void send(const MidiMessage& msg, const DisplayState& display) = 0;
+    virtual void sendReceived(const MidiMessage* msg, const uint32* packetWords, int numPacketWords, const DisplayState& display);
+    virtual void flush() {}
+
+private:
+    static constexpr int CAPACITY = 4096;
+
+    // the decoded controllers, filter results and the words of Universal MIDI Packets travel
+    // along for the text output, MIDI 2.0 packets have no message
+    struct Entry
+    {
+        MidiMessage msg_;
+        bool hasMessage_        { false };
+        DisplayState display_;
+        Array<uint32> packetWords_;
+    };
+
+    static void store(Entry& entry, const MidiMessage* msg, const uint32* packetWords, int numPacketWords, const DisplayState& display);
+    void run() override;
+
+    const String name_;
+    const OverflowPolicy policy_;
+
+    CriticalSection lock_;
+    std::vector<Entry> queue_;
+    int64 head_                 { 0 };
+    int64 tail_                 { 0 };
+    std::vector<int64> queuedKeys_;
+    WaitableEvent dequeued_;
+
+    int64 dropped_              { 0 };
+    int64 coalesced_            { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageSink)
+};
@@ -0,0 +1,313 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessageStatistics.h"
+
+static const char* TYPE_NAMES[] =
+{
+    "note-on",
+    "note-off",
+    "poly-pressure",
+    "control-change",
+    "program-change",
+    "channel-pressure",
+    "pitch-bend",
+    "system-exclusive",
+    "system-common",
+    "system-realtime",
+    "midi2-voice"
+};
+
+// upper bounds of the inter-message interval buckets, in seconds
+static const double INTERVAL_BOUNDS[] = { 0.0001, 0.001, 0.01, 0.1, 1.0 };
+static const char* INTERVAL_NAMES[] = { "<0.1ms", "<1ms", "<10ms", "<100ms", "<1s", ">=1s" };
+
+static const int MAX_CONTROLLERS_SHOWN = 8;
+static const int MAX_NOTES_SHOWN = 8;
+
+MessageStatistics::MessageStatistics(const ControllerState& controllers) : controllerState_(controllers), portRegistry_(MAX_PORTS)
+{
+}
+
+void MessageStatistics::start(int seconds)
+{
+    ports_.reset(new PortStatistics[MAX_PORTS]);
+    for (int p = 0; p < MAX_PORTS; ++p)
+    {
+        PortStatistics& port = ports_[p];
+        for (auto& n : port.types_)
+        {
+            n = 0;
+        }
+        for (auto& n : port.channels_)
+        {
+            n = 0;
+        }
+        for (auto& n : port.noteOns_)
+        {
+            n = 0;
+        }
+        for (auto& n : port.intervals_)
+        {
+            n = 0;
+        }
+        for (int ch = 0; ch < 16; ++ch)
+        {
+            for (int cc = 0; cc < 128; ++cc)
+            {
+                port.controllers_[ch][cc] = 0;
+            }
+        }
+        port.lastTimestamp_ = 0.0;
+    }
+    
+    lastSummary_ = Time::getMillisecondCounterHiRes() * 0.001;
+    active_ = true;
+    startTimer(jmax(1, seconds) * 1000);
+}
+
+void MessageStatistics::setPort(const String& name)
+{
+    const ScopedLock sl(portLock_);
+    
+    port_ = portRegistry_.setPort(name);
+}
+
+void MessageStatistics::add(const uint8* data, int size, double timestamp)
+{
+    if (!active_ || size <= 0)
+    {
+        return;
+    }
+    
+    PortStatistics& port = ports_[port_];
+    const uint8 status = data[0];
+    const int channel = status & 0xf;
+    
+    switch (status & 0xf0)
+    {
+        case 0x80:
+            count(port, NOTE_OFF, channel, timestamp);
+            break;
+        case 0x90:
+            if (size > 2 && data[2] != 0)
+            {
+                count(port, NOTE_ON, channel, timestamp);
+                port.noteOns_[data[1] & 0x7f].fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                count(port, NOTE_OFF, channel, timestamp);
+            }
+            break;
+        case 0xa0:
+            count(port, POLY_PRESSURE, channel, timestamp);
+            break;
+        case 0xb0:
+            count(port, CONTROL_CHANGE, channel, timestamp);
+            if (size > 2)
+            {
+                port.controllers_[channel][data[1] & 0x7f].fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        case 0xc0:
+            count(port, PROGRAM_CHANGE, channel, timestamp);
+            break;
+        case 0xd0:
+            count(port, CHANNEL_PRESSURE, channel, timestamp);
+            break;
+        case 0xe0:
+            count(port, PITCH_BEND, channel, timestamp);
+            break;
+        default:
+            if (status == 0xf0)
+            {
+                count(port, SYSTEM_EXCLUSIVE, -1, timestamp);
+            }
+            else if (status >= 0xf8)
+            {
+                count(port, SYSTEM_REALTIME, -1, timestamp);
+            }
+            else
+            {
+                count(port, SYSTEM_COMMON, -1, timestamp);
+            }
+            break;
+    }
+}
+
+void MessageStatistics::addUniversalPacket(const uint32* words, double timestamp)
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    count(ports_[port_], MIDI2_CHANNEL_VOICE, (int)((words[0] >> 16) & 0xf), timestamp);
+}
+
+void MessageStatistics::count(PortStatistics& port, MessageType type, int channel, double timestamp)
+{
+    port.types_[type].fetch_add(1, std::memory_order_relaxed);
+    if (channel >= 0)
+    {
+        port.channels_[channel].fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    if (port.lastTimestamp_ > 0.0)
+    {
+        const double interval = timestamp - port.lastTimestamp_;
+        int bucket = 0;
+        while (bucket < NUM_INTERVALS - 1 && interval >= INTERVAL_BOUNDS[bucket])
+        {
+            ++bucket;
+        }
+        port.intervals_[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+    port.lastTimestamp_ = timestamp;
+}
+
+void MessageStatistics::timerCallback()
+{
+    printSummary();
+}
+
+void MessageStatistics::printSummary()
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+    const double seconds = jmax(0.001, now - lastSummary_);
+    lastSummary_ = now;
+    
+    StringArray portNames;
+    {
+        const ScopedLock sl(portLock_);
+        portNames = portRegistry_.getNames();
+    }
+    
+    for (int p = 0; p < portNames.size(); ++p)
+    {
+        PortStatistics& port = ports_[p];
+        
+        uint32 total = 0;
+        String types;
+        for (int t = 0; t < NUM_TYPES; ++t)
+        {
+            const uint32 n = port.types_[t].exchange(0, std::memory_order_relaxed);
+            if (n != 0)
+            {
+                types << "  " << TYPE_NAMES[t] << " " << (int64)n;
+                total += n;
+            }
+        }
+        
+        String channels;
+        for (int ch = 0; ch < 16; ++ch)
+        {
+            const uint32 n = port.channels_[ch].exchange(0, std::memory_order_relaxed);
+            if (n != 0)
+            {
+                channels << "  " << (ch + 1) << ":" << (int64)n;
+            }
+        }
+        
+        // only the busiest notes and controllers are shown to keep the summary compact
+        Array<std::pair<uint32, int>> notes;
+        for (int note = 0; note < 128; ++note)
+        {
+            const uint32 n = port.noteOns_[note].exchange(0, std::memory_order_relaxed);
+            if (n != 0)
+            {
+                notes.add({ n, note });
+            }
+        }
+        std::sort(notes.begin(), notes.end(), [] (auto& a, auto& b) { return a.first > b.first; });
+        
+        Array<std::pair<uint32, int>> controllers;
+        for (int ch = 0; ch < 16; ++ch)
+        {
+            for (int cc = 0; cc < 128; ++cc)
+            {
+                const uint32 n = port.controllers_[ch][cc].exchange(0, std::memory_order_relaxed);
+                if (n != 0)
+                {
+                    controllers.add({ n, ch << 7 | cc });
+                }
+            }
+        }
+        std::sort(controllers.begin(), controllers.end(), [] (auto& a, auto& b) { return a.first > b.first; });
+        
+        String intervals;
+        for (int i = 0; i < NUM_INTERVALS; ++i)
+        {
+            const uint32 n = port.intervals_[i].exchange(0, std::memory_order_relaxed);
+            if (n != 0)
+            {
+                intervals << "  " << INTERVAL_NAMES[i] << " " << (int64)n;
+            }
+        }
+        
+        if (total == 0)
+        {
+            continue;
+        }
+        
+        std::cout << "stats";
+        if (portNames[p].isNotEmpty())
+        {
+            std::cout << " \"" << portNames[p] << "\"";
+        }
+        std::cout << "  " << (int64)total << " messages  " << formatRate(total, seconds) << std::endl;
+        std::cout << "  types    " << types.trimStart() << std::endl;
+        if (channels.isNotEmpty())
+        {
+            std::cout << "  channels " << channels.trimStart() << std::endl;
+        }
+        if (!notes.isEmpty())
+        {
+            String line;
+            for (int i = 0; i < jmin(MAX_NOTES_SHOWN, notes.size()); ++i)
+            {
+                line << "  " << notes[i].second << ":" << (int64)notes[i].first;
+            }
+            std::cout << "  note-on  " << line.trimStart() << std::endl;
+        }
+        const ControllerState::Port* values = controllerState_.findPort(portNames[p]);
+        for (int i = 0; i < jmin(MAX_CONTROLLERS_SHOWN, controllers.size()); ++i)
+        {
+            const int ch = controllers[i].second >> 7;
+            const int cc = controllers[i].second & 0x7f;
+            std::cout << "  cc       channel " << String(ch + 1).paddedLeft(' ', 2) << "  " << String(cc).paddedLeft(' ', 3)
+            << "  last " << String(values != nullptr ? values->channels_[ch].get(cc) : -1).paddedLeft(' ', 3)
+            << "  " << formatRate(controllers[i].first, seconds) << std::endl;
+        }
+        if (intervals.isNotEmpty())
+        {
+            std::cout << "  interval " << intervals.trimStart() << std::endl;
+        }
+    }
+}
+
+String MessageStatistics::formatRate(uint32 count, double seconds)
+{
+    return String(count / seconds, 1) + "/s";
+}
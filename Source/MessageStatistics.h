@@ -0,0 +1,92 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "ControllerState.h"
+#include "PortRegistry.h"
+
+/**
+ * Aggregates the received messages in fixed-size counter arrays and periodically prints a
+ * compact summary instead of a line for each message.
+ *
+ * Counting a message only takes a handful of relaxed atomic increments, the counters are
+ * read and reset by the message thread when the summary is printed. The last controller values
+ * are read from the shared controller state of each port.
+ */
+class MessageStatistics : public Timer
+{
+public:
+    MessageStatistics(const ControllerState& controllers);
+
+    void start(int seconds);
+    bool isActive() const { return active_; }
+
+    void setPort(const String& name);
+    void add(const uint8* data, int size, double timestamp);
+    void addUniversalPacket(const uint32* words, double timestamp);
+
+    void printSummary();
+
+private:
+    enum MessageType
+    {
+        NOTE_ON,
+        NOTE_OFF,
+        POLY_PRESSURE,
+        CONTROL_CHANGE,
+        PROGRAM_CHANGE,
+        CHANNEL_PRESSURE,
+        PITCH_BEND,
+        SYSTEM_EXCLUSIVE,
+        SYSTEM_COMMON,
+        SYSTEM_REALTIME,
+        MIDI2_CHANNEL_VOICE,
+        NUM_TYPES
+    };
+
+    static constexpr int MAX_PORTS = 8;
+    static constexpr int NUM_INTERVALS = 6;
+
+    struct PortStatistics
+    {
+        std::atomic<uint32> types_[NUM_TYPES];
+        std::atomic<uint32> channels_[16];
+        std::atomic<uint32> noteOns_[128];
+        std::atomic<uint32> controllers_[16][128];
+        std::atomic<uint32> intervals_[NUM_INTERVALS];
+        double lastTimestamp_;
+    };
+
+    void timerCallback() override;
+
+    void count(PortStatistics& port, MessageType type, int channel, double timestamp);
+    static String formatRate(uint32 count, double seconds);
+
+    const ControllerState& controllerState_;
+    std::atomic<bool> active_       { false };
+    std::atomic<int> port_          { 0 };
+    CriticalSection portLock_;
+    PortRegistry portRegistry_;
+    std::unique_ptr<PortStatistics[]> ports_;
+    double lastSummary_             { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageStatistics)
+};
@@ -0,0 +1,150 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessageTracer.h"
+
+static const char* STAGE_NAMES[] = { "message", "filter", "pass-through", "script", "output" };
+
+MessageTracer::Span::Span(MessageTracer& tracer, Stage stage, uint8 status) :
+    tracer_(tracer.isActive() ? &tracer : nullptr), stage_(stage), status_(status)
+{
+    if (tracer_ == nullptr)
+    {
+        return;
+    }
+    
+    ThreadSpans& spans = tracer_->getThreadSpans();
+    previous_ = spans.message_;
+    if (stage == MESSAGE)
+    {
+        spans.message_ = ++spans.messages_;
+    }
+    message_ = spans.message_;
+    start_ = Metrics::getNanoseconds();
+}
+
+MessageTracer::Span::~Span()
+{
+    if (tracer_ == nullptr)
+    {
+        return;
+    }
+    
+    const int64 end = Metrics::getNanoseconds();
+    
+    // the ring is only written by its own thread and read once all threads stopped
+    ThreadSpans& spans = tracer_->getThreadSpans();
+    const uint64 written = spans.written_.load(std::memory_order_relaxed);
+    spans.events_[(size_t)(written % SPANS_PER_THREAD)] = { start_, end, message_, (uint8)stage_, status_ };
+    spans.written_.store(written + 1, std::memory_order_relaxed);
+    
+    // a message that's processed while another one is, like coalesced values, doesn't take over
+    // the spans of the outer message
+    spans.message_ = previous_;
+}
+
+bool MessageTracer::start(const File& file)
+{
+    if (!file.getParentDirectory().createDirectory())
+    {
+        return false;
+    }
+    
+    file_ = file;
+    start_ = Metrics::getNanoseconds();
+    active_ = true;
+    return true;
+}
+
+void MessageTracer::stop()
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    active_ = false;
+    write();
+}
+
+MessageTracer::ThreadSpans& MessageTracer::getThreadSpans()
+{
+    // the ring of a thread is only allocated the first time it traces something
+    thread_local ThreadSpans* spans = nullptr;
+    if (spans == nullptr || spans->owner_ != this)
+    {
+        auto* current = Thread::getCurrentThread();
+        
+        const ScopedLock sl(lock_);
+        spans = threads_.add(new ThreadSpans());
+        spans->owner_ = this;
+        spans->number_ = threads_.size();
+        spans->name_ = current != nullptr ? current->getThreadName() : String("Main");
+        spans->events_.resize(SPANS_PER_THREAD);
+    }
+    return *spans;
+}
+
+void MessageTracer::write() const
+{
+    file_.deleteFile();
+    FileOutputStream output(file_);
+    if (output.failedToOpen())
+    {
+        std::cerr << "Couldn't create file \"" << file_.getFullPathName() << "\"" << std::endl;
+        return;
+    }
+    
+    int64 spanCount = 0;
+    int64 messageCount = 0;
+    
+    output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    output << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"receivemidi\"}}";
+    
+    const ScopedLock sl(lock_);
+    for (auto* spans : threads_)
+    {
+        output << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << spans->number_
+               << ",\"args\":{\"name\":" << JSON::toString(spans->name_) << "}}";
+        
+        const uint64 written = spans->written_.load();
+        const uint64 first = written > (uint64)SPANS_PER_THREAD ? written - SPANS_PER_THREAD : 0;
+        for (uint64 i = first; i < written; ++i)
+        {
+            const Event& event = spans->events_[(size_t)(i % SPANS_PER_THREAD)];
+            
+            // the timestamps are in microseconds, with nanosecond precision
+            output << ",\n{\"name\":\"" << STAGE_NAMES[event.stage_] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << spans->number_
+                   << ",\"ts\":" << String((event.start_ - start_) * 0.001, 3)
+                   << ",\"dur\":" << String((event.end_ - event.start_) * 0.001, 3)
+                   << ",\"args\":{\"message\":" << (int64)event.message_;
+            if (event.stage_ == MESSAGE)
+            {
+                output << ",\"status\":\"" << String::toHexString(event.status_).paddedLeft('0', 2).toUpperCase() << "\"";
+                messageCount += 1;
+            }
+            output << "}}";
+            spanCount += 1;
+        }
+    }
+    
+    output << "\n]}\n";
+    output.flush();
+    
+    std::cerr << "Traced " << messageCount << " messages in " << spanCount << " spans to \"" << file_.getFullPathName() << "\"" << std::endl;
+}
@@ -0,0 +1,105 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "Metrics.h"
+
+/**
+ * Traces the processing stages of each message and writes them as a Chrome trace JSON file on
+ * exit, which can be opened in Perfetto or chrome://tracing.
+ *
+ * Each thread that processes messages gets its own ring of spans that only it writes, so
+ * tracing never waits for another thread. A message span starts when the message is handed to
+ * ReceiveMIDI by the input and ends when it's completely processed, with nested spans for the
+ * filters, the pass-through, the script and the output. The rings keep the most recent spans
+ * of each thread.
+ */
+class MessageTracer
+{
+public:
+    enum Stage
+    {
+        MESSAGE,
+        FILTER,
+        PASS_THROUGH,
+        SCRIPT,
+        OUTPUT
+    };
+
+    // traces a stage until it goes out of scope, only when tracing is active
+    class Span
+    {
+    public:
+        Span(MessageTracer& tracer, Stage stage, uint8 status = 0);
+        ~Span();
+
+    private:
+        MessageTracer* const tracer_;
+        const Stage stage_;
+        const uint8 status_;
+        uint32 message_         { 0 };
+        uint32 previous_        { 0 };
+        int64 start_            { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE (Span)
+    };
+
+    static constexpr int SPANS_PER_THREAD = 1 << 18;
+
+    MessageTracer() = default;
+
+    bool start(const File& file);
+    void stop();
+    bool isActive() const { return active_.load(std::memory_order_relaxed); }
+
+private:
+    struct Event
+    {
+        int64 start_;
+        int64 end_;
+        uint32 message_;
+        uint8 stage_;
+        uint8 status_;
+    };
+
+    struct ThreadSpans
+    {
+        const MessageTracer* owner_     { nullptr };
+        int number_                     { 0 };
+        String name_;
+        std::vector<Event> events_;
+        std::atomic<uint64> written_    { 0 };
+        uint32 message_                 { 0 };
+        uint32 messages_                { 0 };
+    };
+
+    ThreadSpans& getThreadSpans();
+    void write() const;
+
+    std::atomic<bool> active_       { false };
+    File file_;
+    int64 start_                    { 0 };
+
+    CriticalSection lock_;
+    OwnedArray<ThreadSpans> threads_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageTracer)
+};
@@ -0,0 +1,328 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MessageTransform.h"
+
+#include "ApplicationState.h"
+
+MessageTransform::MessageTransform()
+{
+    reset();
+}
+
+void MessageTransform::reset()
+{
+    identity_ = true;
+    for (int c = 0; c < 16; ++c)
+    {
+        channelMap_[c] = (uint8)c;
+        for (int v = 0; v < 128; ++v)
+        {
+            noteMap_[c][v] = (uint8)v;
+            velocityMap_[c][v] = (uint8)v;
+            controllerMap_[c][v] = (uint8)v;
+            controllerCurve_[c][v] = 0;
+        }
+    }
+    
+    for (int v = 0; v < 128; ++v)
+    {
+        controllerCurves_[0][v] = (uint8)v;
+    }
+    numControllerCurves_ = 1;
+}
+
+bool MessageTransform::isIdentity() const
+{
+    return identity_;
+}
+
+bool MessageTransform::parse(const String& spec, const ApplicationState& state, String& error)
+{
+    reset();
+    
+    StringArray tokens;
+    tokens.addTokens(spec, true);
+    tokens.removeEmptyStrings(true);
+    if (tokens.isEmpty() || (tokens.size() == 1 && tokens[0] == "-"))
+    {
+        return true;
+    }
+    
+    // each step changes the tables of the channels that were selected with "on", all by default
+    BigInteger channels;
+    channels.setRange(0, 16, true);
+    
+    for (int i = 0; i < tokens.size(); i += 2)
+    {
+        const String key = tokens[i];
+        if (i + 1 >= tokens.size())
+        {
+            error = "Missing value for transform \"" + key + "\"";
+            return false;
+        }
+        
+        const String value = tokens[i + 1];
+        if (key.equalsIgnoreCase("on"))
+        {
+            channels = state.asValueSet(value, false, 1, 16) >> 1;
+        }
+        else if (key.equalsIgnoreCase("ch"))
+        {
+            const int channel = state.asDecOrHex7BitValue(value);
+            if (channel < 1 || channel > 16)
+            {
+                error = "Transform channel \"" + value + "\" should be between 1 and 16";
+                return false;
+            }
+            for (int c = 0; c < 16; ++c)
+            {
+                if (channels[c])
+                {
+                    channelMap_[c] = (uint8)(channel - 1);
+                }
+            }
+        }
+        else if (key.equalsIgnoreCase("transpose"))
+        {
+            const int transpose = value.getIntValue();
+            for (int c = 0; c < 16; ++c)
+            {
+                for (int v = 0; channels[c] && v < 128; ++v)
+                {
+                    if (noteMap_[c][v] != DROPPED)
+                    {
+                        const int note = noteMap_[c][v] + transpose;
+                        noteMap_[c][v] = isPositiveAndBelow(note, 128) ? (uint8)note : DROPPED;
+                    }
+                }
+            }
+        }
+        else if (key.equalsIgnoreCase("clamp"))
+        {
+            const BigInteger range = state.asValueSet(value, true, 0, 127);
+            const int lowest = range.findNextSetBit(0);
+            const int highest = range.getHighestBit();
+            if (lowest < 0)
+            {
+                error = "Missing note range for transform \"clamp\"";
+                return false;
+            }
+            for (int c = 0; c < 16; ++c)
+            {
+                for (int v = 0; channels[c] && v < 128; ++v)
+                {
+                    int note = noteMap_[c][v];
+                    if (note == DROPPED)
+                    {
+                        continue;
+                    }
+                    
+                    // notes are moved by octaves into ranges that span at least one octave
+                    if (highest - lowest >= 11)
+                    {
+                        while (note < lowest)
+                        {
+                            note += 12;
+                        }
+                        while (note > highest)
+                        {
+                            note -= 12;
+                        }
+                    }
+                    noteMap_[c][v] = (uint8)jlimit(lowest, highest, note);
+                }
+            }
+        }
+        else if (key.equalsIgnoreCase("vel"))
+        {
+            const double curve = value.getDoubleValue();
+            if (curve <= 0.0)
+            {
+                error = "Velocity curve \"" + value + "\" should be larger than 0";
+                return false;
+            }
+            for (int c = 0; c < 16; ++c)
+            {
+                // a velocity of zero is a note off and stays one
+                for (int v = 1; channels[c] && v < 128; ++v)
+                {
+                    velocityMap_[c][v] = (uint8)jlimit(1, 127, roundToInt(127.0 * std::pow(velocityMap_[c][v] / 127.0, curve)));
+                }
+            }
+        }
+        else if (key.equalsIgnoreCase("ccmap"))
+        {
+            if (!parseControllerMap(value, channels, state, error))
+            {
+                return false;
+            }
+        }
+        else if (key.equalsIgnoreCase("ccscale"))
+        {
+            if (!parseControllerScale(value, channels, state, error))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            error = "Unknown transform \"" + key + "\", use on, ch, transpose, clamp, vel, ccmap or ccscale";
+            return false;
+        }
+        
+        identity_ = false;
+    }
+    
+    return true;
+}
+
+bool MessageTransform::parseControllerMap(const String& value, const BigInteger& channels, const ApplicationState& state, String& error)
+{
+    StringArray pairs;
+    pairs.addTokens(value, ",", "");
+    for (auto& pair : pairs)
+    {
+        if (!pair.containsChar('>'))
+        {
+            error = "Controller map \"" + pair + "\" should be written as from>to";
+            return false;
+        }
+        
+        const int from = state.asDecOrHex7BitValue(pair.upToFirstOccurrenceOf(">", false, false).trim());
+        const uint8 to = state.asDecOrHex7BitValue(pair.fromFirstOccurrenceOf(">", false, false).trim());
+        for (int c = 0; c < 16; ++c)
+        {
+            if (channels[c])
+            {
+                controllerMap_[c][from] = to;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool MessageTransform::parseControllerScale(const String& value, const BigInteger& channels, const ApplicationState& state, String& error)
+{
+    // the target range is kept in the order it's written in, so that it can invert the values
+    BigInteger controllers;
+    String range = value;
+    if (value.containsChar('>'))
+    {
+        controllers = state.asValueSet(value.upToFirstOccurrenceOf(">", false, false), false, 0, 127);
+        range = value.fromFirstOccurrenceOf(">", false, false);
+    }
+    else
+    {
+        controllers.setRange(0, 128, true);
+    }
+    
+    if (!range.containsChar('-'))
+    {
+        error = "Controller scale \"" + value + "\" should have a range like 20-100";
+        return false;
+    }
+    
+    const int lowest = state.asDecOrHex7BitValue(range.upToFirstOccurrenceOf("-", false, false).trim());
+    const int highest = state.asDecOrHex7BitValue(range.fromFirstOccurrenceOf("-", false, false).trim());
+    
+    // each curve that the selected controllers use is scaled once, into an identical curve that
+    // already exists or into a new one
+    int scaled[MAX_CONTROLLER_CURVES];
+    std::fill(std::begin(scaled), std::end(scaled), -1);
+    for (int c = 0; c < 16; ++c)
+    {
+        for (int cc = 0; channels[c] && cc < 128; ++cc)
+        {
+            if (!controllers[cc])
+            {
+                continue;
+            }
+            
+            const int curve = controllerCurve_[c][cc];
+            if (scaled[curve] < 0)
+            {
+                uint8 values[128];
+                for (int v = 0; v < 128; ++v)
+                {
+                    values[v] = (uint8)(lowest + roundToInt((highest - lowest) * controllerCurves_[curve][v] / 127.0));
+                }
+                
+                int index = 0;
+                while (index < numControllerCurves_ && memcmp(controllerCurves_[index], values, sizeof(values)) != 0)
+                {
+                    index += 1;
+                }
+                if (index == numControllerCurves_)
+                {
+                    if (numControllerCurves_ == MAX_CONTROLLER_CURVES)
+                    {
+                        error = "Controller scales can create at most " + String(MAX_CONTROLLER_CURVES - 1) + " different value curves";
+                        return false;
+                    }
+                    memcpy(controllerCurves_[index], values, sizeof(values));
+                    numControllerCurves_ += 1;
+                }
+                scaled[curve] = index;
+            }
+            controllerCurve_[c][cc] = (uint8)scaled[curve];
+        }
+    }
+    
+    return true;
+}
+
+int MessageTransform::apply(const uint8* data, int size, uint8* out) const
+{
+    // only channel voice messages are transformed
+    jassert(data[0] >= 0x80 && data[0] < 0xf0 && size <= 3);
+    
+    const int type = data[0] & 0xf0;
+    const int channel = data[0] & 0x0f;
+    
+    out[0] = (uint8)(type | channelMap_[channel]);
+    switch (type)
+    {
+        case 0x80:
+        case 0x90:
+        case 0xa0:
+        {
+            const uint8 note = noteMap_[channel][data[1] & 0x7f];
+            if (note == DROPPED)
+            {
+                return 0;
+            }
+            out[1] = note;
+            out[2] = type == 0x90 ? velocityMap_[channel][data[2] & 0x7f] : data[2];
+            break;
+        }
+        case 0xb0:
+            out[1] = controllerMap_[channel][data[1] & 0x7f];
+            out[2] = controllerCurves_[controllerCurve_[channel][data[1] & 0x7f]][data[2] & 0x7f];
+            break;
+        default:
+            for (int i = 1; i < size; ++i)
+            {
+                out[i] = data[i];
+            }
+            break;
+    }
+    
+    return size;
+}
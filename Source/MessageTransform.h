@@ -0,0 +1,65 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+class ApplicationState;
+
+/**
+ * Rewrites channel voice messages through lookup tables that are compiled from a transform
+ * specification, like "ch 2 transpose 12 vel 0.7" or "on 10 clamp C1-B2 ccmap 1>74".
+ *
+ * Every table has an entry per source channel and data byte value, so transforming a message
+ * only costs a load per byte, however many steps the specification has. Notes that are
+ * transposed out of range are dropped, both for their note on and note off.
+ */
+class MessageTransform
+{
+public:
+    MessageTransform();
+
+    bool parse(const String& spec, const ApplicationState& state, String& error);
+    bool isIdentity() const;
+
+    // writes the transformed message to out and returns its size, 0 when it's dropped
+    int apply(const uint8* data, int size, uint8* out) const;
+
+private:
+    static constexpr uint8 DROPPED = 0xff;
+    static constexpr int MAX_CONTROLLER_CURVES = 64;
+
+    void reset();
+    bool parseControllerMap(const String& value, const BigInteger& channels, const ApplicationState& state, String& error);
+    bool parseControllerScale(const String& value, const BigInteger& channels, const ApplicationState& state, String& error);
+
+    bool identity_;
+    uint8 channelMap_[16];
+    uint8 noteMap_[16][128];
+    uint8 velocityMap_[16][128];
+    uint8 controllerMap_[16][128];
+
+    // controller values go through one of a few value curves, selected by source channel and
+    // controller number, curve 0 leaves the values as they are
+    uint8 controllerCurve_[16][128];
+    uint8 controllerCurves_[MAX_CONTROLLER_CURVES][128];
+    int numControllerCurves_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MessageTransform)
+};
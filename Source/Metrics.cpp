@@ -0,0 +1,405 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Metrics.h"
+
+#include "UserSignal.h"
+
+static const char* TYPE_NAMES[] =
+{
+    "note_on",
+    "note_off",
+    "poly_pressure",
+    "control_change",
+    "program_change",
+    "channel_pressure",
+    "pitch_bend",
+    "system_exclusive",
+    "system_common",
+    "system_realtime",
+    "midi2_channel_voice"
+};
+
+static const char* STAGE_NAMES[] = { "filter", "script", "pass_through", "output", "process" };
+
+static const char* COUNTER_NAMES[] = { "script_runs", "script_errors", "pass_through_messages", "pass_through_bytes" };
+static const char* COUNTER_HELP[] =
+{
+    "Script executions",
+    "Script executions that failed",
+    "Messages sent to the pass-through port",
+    "Bytes sent to the pass-through port"
+};
+
+static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+Metrics::Metrics(Listener& listener) : listener_(listener), ports_(MAX_PORTS)
+{
+}
+
+Metrics::~Metrics()
+{
+    stopTimer();
+}
+
+bool Metrics::start(const File& file, int seconds)
+{
+    if (!file.getParentDirectory().createDirectory())
+    {
+        return false;
+    }
+    
+    file_ = file;
+    UserSignal::install();
+    active_ = true;
+    
+    writeExport();
+    startTimer(jmax(1, seconds) * 1000);
+    return true;
+}
+
+void Metrics::stop()
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    stopTimer();
+    active_ = false;
+    writeExport();
+    printSummary();
+}
+
+void Metrics::setPort(const String& name)
+{
+    const ScopedLock sl(lock_);
+    
+    port_ = ports_.setPort(name);
+}
+
+void Metrics::countMessage(const MidiMessage* msg, bool passed)
+{
+    MessageType type = MIDI2_CHANNEL_VOICE;
+    if (msg != nullptr)
+    {
+        const uint8 status = msg->getRawData()[0];
+        switch (status & 0xf0)
+        {
+            case 0x80: type = NOTE_OFF; break;
+            case 0x90: type = msg->getRawDataSize() > 2 && msg->getRawData()[2] != 0 ? NOTE_ON : NOTE_OFF; break;
+            case 0xa0: type = POLY_PRESSURE; break;
+            case 0xb0: type = CONTROL_CHANGE; break;
+            case 0xc0: type = PROGRAM_CHANGE; break;
+            case 0xd0: type = CHANNEL_PRESSURE; break;
+            case 0xe0: type = PITCH_BEND; break;
+            default:
+                type = status == 0xf0 ? SYSTEM_EXCLUSIVE : (status >= 0xf8 ? SYSTEM_REALTIME : SYSTEM_COMMON);
+                break;
+        }
+    }
+    
+    ThreadCounters& counters = getThreadCounters();
+    const int port = port_.load(std::memory_order_relaxed);
+    add(counters.received_[port][type], 1);
+    if (passed)
+    {
+        add(counters.passed_[port][type], 1);
+    }
+}
+
+void Metrics::count(Counter counter, int64 amount)
+{
+    add(getThreadCounters().counters_[counter], (uint64)amount);
+}
+
+void Metrics::addLatency(Stage stage, int64 nanoseconds)
+{
+    ThreadCounters& counters = getThreadCounters();
+    add(counters.buckets_[stage][getBucket(nanoseconds)], 1);
+    add(counters.sums_[stage], (uint64)jmax((int64)0, nanoseconds));
+}
+
+void Metrics::writePendingExport()
+{
+    if (UserSignal::receivedSince(signalsSeen_) && active_)
+    {
+        writeExport();
+    }
+}
+
+int64 Metrics::getNanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Metrics::timerCallback()
+{
+    writeExport();
+}
+
+Metrics::ThreadCounters& Metrics::getThreadCounters()
+{
+    // the counters of a thread are only created the first time it counts something
+    thread_local ThreadCounters* counters = nullptr;
+    if (counters == nullptr || counters->owner_ != this)
+    {
+        const ScopedLock sl(lock_);
+        counters = threads_.add(new ThreadCounters());
+        counters->owner_ = this;
+    }
+    return *counters;
+}
+
+void Metrics::add(std::atomic<uint64>& counter, uint64 amount)
+{
+    // only the owning thread writes its counters, so there's no need for a locked increment
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+int Metrics::getBucket(int64 nanoseconds)
+{
+    if (nanoseconds < SUB_BUCKETS)
+    {
+        return (int)jmax((int64)0, nanoseconds);
+    }
+    
+    const uint64 value = (uint64)nanoseconds;
+    const int highestBit = (value >> 32) != 0 ? 32 + findHighestSetBit((uint32)(value >> 32)) : findHighestSetBit((uint32)value);
+    const int shift = highestBit - SUB_BUCKET_BITS;
+    if (shift > MAX_SHIFT)
+    {
+        return NUM_BUCKETS - 1;
+    }
+    
+    return (shift + 1) * SUB_BUCKETS + (int)(value >> shift) - SUB_BUCKETS;
+}
+
+int64 Metrics::getBucketValue(int bucket)
+{
+    // the highest value that falls in the bucket
+    const int group = bucket / SUB_BUCKETS;
+    const int64 sub = bucket % SUB_BUCKETS;
+    if (group == 0)
+    {
+        return sub;
+    }
+    
+    const int shift = group - 1;
+    return (((SUB_BUCKETS + sub) << shift) + ((int64)1 << shift)) - 1;
+}
+
+int64 Metrics::getQuantile(const uint64* buckets, double quantile)
+{
+    uint64 total = 0;
+    for (int b = 0; b < NUM_BUCKETS; ++b)
+    {
+        total += buckets[b];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    
+    const uint64 target = jmax((uint64)1, (uint64)std::ceil((double)total * quantile));
+    uint64 count = 0;
+    for (int b = 0; b < NUM_BUCKETS; ++b)
+    {
+        count += buckets[b];
+        if (count >= target)
+        {
+            return getBucketValue(b);
+        }
+    }
+    return getBucketValue(NUM_BUCKETS - 1);
+}
+
+String Metrics::escapeLabel(const String& value)
+{
+    return value.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+}
+
+std::unique_ptr<Metrics::Totals> Metrics::collect() const
+{
+    std::unique_ptr<Totals> totals(new Totals());
+    
+    const ScopedLock sl(lock_);
+    for (auto* counters : threads_)
+    {
+        for (int p = 0; p < MAX_PORTS; ++p)
+        {
+            for (int t = 0; t < NUM_TYPES; ++t)
+            {
+                totals->received_[p][t] += counters->received_[p][t].load(std::memory_order_relaxed);
+                totals->passed_[p][t] += counters->passed_[p][t].load(std::memory_order_relaxed);
+            }
+        }
+        for (int c = 0; c < NUM_COUNTERS; ++c)
+        {
+            totals->counters_[c] += counters->counters_[c].load(std::memory_order_relaxed);
+        }
+        for (int s = 0; s < NUM_STAGES; ++s)
+        {
+            for (int b = 0; b < NUM_BUCKETS; ++b)
+            {
+                totals->buckets_[s][b] += counters->buckets_[s][b].load(std::memory_order_relaxed);
+            }
+            totals->sums_[s] += counters->sums_[s].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+void Metrics::writeExport()
+{
+    auto totals = collect();
+    StringArray portNames;
+    {
+        const ScopedLock sl(lock_);
+        portNames = ports_.getNames();
+    }
+    Array<Queue> queues;
+    listener_.collectQueues(queues);
+    
+    String text;
+    
+    const char* messageMetrics[][2] =
+    {
+        { "received", "Messages received" },
+        { "filtered", "Messages that didn't match the filters" },
+        { "passed", "Messages that matched the filters" }
+    };
+    for (int m = 0; m < 3; ++m)
+    {
+        const String name = String("receivemidi_messages_") + messageMetrics[m][0] + "_total";
+        text << "# HELP " << name << " " << messageMetrics[m][1] << " per input port and type.\n"
+             << "# TYPE " << name << " counter\n";
+        for (int p = 0; p < portNames.size(); ++p)
+        {
+            for (int t = 0; t < NUM_TYPES; ++t)
+            {
+                const uint64 received = totals->received_[p][t];
+                if (received == 0)
+                {
+                    continue;
+                }
+                
+                const uint64 passed = totals->passed_[p][t];
+                const uint64 value = m == 0 ? received : (m == 1 ? received - passed : passed);
+                text << name << "{port=\"" << escapeLabel(portNames[p]) << "\",type=\"" << TYPE_NAMES[t] << "\"} " << (int64)value << "\n";
+            }
+        }
+    }
+    
+    for (int c = 0; c < NUM_COUNTERS; ++c)
+    {
+        const String name = String("receivemidi_") + COUNTER_NAMES[c] + "_total";
+        text << "# HELP " << name << " " << COUNTER_HELP[c] << ".\n"
+             << "# TYPE " << name << " counter\n"
+             << name << " " << (int64)totals->counters_[c] << "\n";
+    }
+    
+    text << "# HELP receivemidi_queue_depth Messages waiting in the queue of an output.\n"
+         << "# TYPE receivemidi_queue_depth gauge\n";
+    for (auto& queue : queues)
+    {
+        if (queue.depth_ >= 0)
+        {
+            text << "receivemidi_queue_depth{queue=\"" << escapeLabel(queue.name_) << "\"} " << queue.depth_ << "\n";
+        }
+    }
+    text << "# HELP receivemidi_queue_dropped_total Messages dropped by the queue of an output.\n"
+         << "# TYPE receivemidi_queue_dropped_total counter\n";
+    for (auto& queue : queues)
+    {
+        text << "receivemidi_queue_dropped_total{queue=\"" << escapeLabel(queue.name_) << "\"} " << queue.dropped_ << "\n";
+    }
+    text << "# HELP receivemidi_queue_coalesced_total Messages replaced by a newer value in the queue of an output.\n"
+         << "# TYPE receivemidi_queue_coalesced_total counter\n";
+    for (auto& queue : queues)
+    {
+        text << "receivemidi_queue_coalesced_total{queue=\"" << escapeLabel(queue.name_) << "\"} " << queue.coalesced_ << "\n";
+    }
+    
+    text << "# HELP receivemidi_stage_latency_seconds Time spent in each processing stage.\n"
+         << "# TYPE receivemidi_stage_latency_seconds summary\n";
+    for (int s = 0; s < NUM_STAGES; ++s)
+    {
+        uint64 count = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b)
+        {
+            count += totals->buckets_[s][b];
+        }
+        
+        // quantiles without observations are not a number in the exposition format
+        const String labels = String("stage=\"") + STAGE_NAMES[s] + "\"";
+        for (double quantile : QUANTILES)
+        {
+            text << "receivemidi_stage_latency_seconds{" << labels << ",quantile=\"" << String(quantile) << "\"} "
+                 << (count == 0 ? String("NaN") : String(getQuantile(totals->buckets_[s], quantile) * 1.0e-9, 9)) << "\n";
+        }
+        text << "receivemidi_stage_latency_seconds_sum{" << labels << "} " << String(totals->sums_[s] * 1.0e-9, 9) << "\n"
+             << "receivemidi_stage_latency_seconds_count{" << labels << "} " << (int64)count << "\n";
+    }
+    
+    // the file is replaced at once, so that collectors never read a partial file
+    TemporaryFile temp(file_);
+    if (!temp.getFile().replaceWithText(text) || !temp.overwriteTargetFileWithTemporary())
+    {
+        std::cerr << "Couldn't write metrics to \"" << file_.getFullPathName() << "\"" << std::endl;
+    }
+}
+
+void Metrics::printSummary() const
+{
+    auto totals = collect();
+    
+    uint64 received = 0;
+    uint64 passed = 0;
+    for (int p = 0; p < MAX_PORTS; ++p)
+    {
+        for (int t = 0; t < NUM_TYPES; ++t)
+        {
+            received += totals->received_[p][t];
+            passed += totals->passed_[p][t];
+        }
+    }
+    
+    std::cerr << "Metrics received " << (int64)received << " messages, " << (int64)(received - passed) << " filtered out and "
+              << (int64)passed << " passed, " << (int64)totals->counters_[SCRIPT_RUNS] << " script runs with "
+              << (int64)totals->counters_[SCRIPT_ERRORS] << " errors, " << (int64)totals->counters_[PASS_THROUGH_MESSAGES]
+              << " pass-through messages of " << (int64)totals->counters_[PASS_THROUGH_BYTES] << " bytes" << std::endl;
+    
+    for (int s = 0; s < NUM_STAGES; ++s)
+    {
+        uint64 count = 0;
+        for (int b = 0; b < NUM_BUCKETS; ++b)
+        {
+            count += totals->buckets_[s][b];
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+        
+        auto micros = [&totals, s] (double quantile) { return String(getQuantile(totals->buckets_[s], quantile) * 0.001, 2); };
+        std::cerr << "  " << String(STAGE_NAMES[s]).paddedRight(' ', 12) << " mean " << String(totals->sums_[s] * 0.001 / count, 2)
+                  << " us, p50 " << micros(0.5) << " us, p99 " << micros(0.99) << " us, p99.9 " << micros(0.999)
+                  << " us, max " << micros(1.0) << " us" << std::endl;
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "PortRegistry.h"
+
+/**
+ * Collects counters and latency histograms of the processing stages, and exports them as a
+ * Prometheus text file.
+ *
+ * Each thread that processes messages gets its own block of counters, which only it writes
+ * with relaxed atomic stores, so counting never waits or contends for a cache line. The
+ * latencies are kept in log-linear histograms with 32 buckets per power of two, like HDR
+ * histograms, which gives their quantiles within 3%. The blocks of all threads are summed when
+ * the file is written, every number of seconds, on SIGUSR1 (Linux/macOS) and when stopped.
+ */
+class Metrics : public Timer
+{
+public:
+    enum Stage
+    {
+        FILTER,
+        SCRIPT,
+        PASS_THROUGH,
+        OUTPUT,
+        PROCESS,
+        NUM_STAGES
+    };
+
+    enum Counter
+    {
+        SCRIPT_RUNS,
+        SCRIPT_ERRORS,
+        PASS_THROUGH_MESSAGES,
+        PASS_THROUGH_BYTES,
+        NUM_COUNTERS
+    };
+
+    struct Queue
+    {
+        String name_;
+        int64 depth_            { -1 };
+        int64 dropped_          { 0 };
+        int64 coalesced_        { 0 };
+    };
+
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual void collectQueues(Array<Queue>& queues) = 0;
+    };
+
+    // measures a stage until it goes out of scope, only when the metrics are active
+    class StageTimer
+    {
+    public:
+        StageTimer(Metrics& metrics, Stage stage) :
+            metrics_(metrics.isActive() ? &metrics : nullptr), stage_(stage), start_(metrics_ != nullptr ? getNanoseconds() : 0) {}
+        ~StageTimer()
+        {
+            if (metrics_ != nullptr)
+            {
+                metrics_->addLatency(stage_, getNanoseconds() - start_);
+            }
+        }
+
+    private:
+        Metrics* const metrics_;
+        const Stage stage_;
+        const int64 start_;
+
+        JUCE_DECLARE_NON_COPYABLE (StageTimer)
+    };
+
+    Metrics(Listener& listener);
+    ~Metrics() override;
+
+    bool start(const File& file, int seconds);
+    void stop();
+    bool isActive() const { return active_.load(std::memory_order_relaxed); }
+
+    void setPort(const String& name);
+    void countMessage(const MidiMessage* msg, bool passed);
+    void count(Counter counter, int64 amount = 1);
+    void addLatency(Stage stage, int64 nanoseconds);
+    void writePendingExport();
+
+    static int64 getNanoseconds();
+
+private:
+    enum MessageType
+    {
+        NOTE_ON,
+        NOTE_OFF,
+        POLY_PRESSURE,
+        CONTROL_CHANGE,
+        PROGRAM_CHANGE,
+        CHANNEL_PRESSURE,
+        PITCH_BEND,
+        SYSTEM_EXCLUSIVE,
+        SYSTEM_COMMON,
+        SYSTEM_REALTIME,
+        MIDI2_CHANNEL_VOICE,
+        NUM_TYPES
+    };
+
+    static constexpr int MAX_PORTS = 8;
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // the buckets go up to 2^37 ns, a bit over two minutes
+    static constexpr int MAX_SHIFT = 32;
+    static constexpr int NUM_BUCKETS = (MAX_SHIFT + 2) * SUB_BUCKETS;
+
+    struct ThreadCounters
+    {
+        const Metrics* owner_;
+        std::atomic<uint64> received_[MAX_PORTS][NUM_TYPES];
+        std::atomic<uint64> passed_[MAX_PORTS][NUM_TYPES];
+        std::atomic<uint64> counters_[NUM_COUNTERS];
+        std::atomic<uint64> buckets_[NUM_STAGES][NUM_BUCKETS];
+        std::atomic<uint64> sums_[NUM_STAGES];
+    };
+
+    struct Totals
+    {
+        uint64 received_[MAX_PORTS][NUM_TYPES];
+        uint64 passed_[MAX_PORTS][NUM_TYPES];
+        uint64 counters_[NUM_COUNTERS];
+        uint64 buckets_[NUM_STAGES][NUM_BUCKETS];
+        uint64 sums_[NUM_STAGES];
+    };
+
+    void timerCallback() override;
+
+    ThreadCounters& getThreadCounters();
+    static void add(std::atomic<uint64>& counter, uint64 amount);
+    static int getBucket(int64 nanoseconds);
+    static int64 getBucketValue(int bucket);
+    static int64 getQuantile(const uint64* buckets, double quantile);
+    static String escapeLabel(const String& value);
+
+    std::unique_ptr<Totals> collect() const;
+    void writeExport();
+    void printSummary() const;
+
+    Listener& listener_;
+    std::atomic<bool> active_       { false };
+    File file_;
+    uint32 signalsSeen_             { 0 };
+
+    std::atomic<int> port_          { 0 };
+    CriticalSection lock_;
+    PortRegistry ports_;
+    OwnedArray<ThreadCounters> threads_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Metrics)
+};
@@ -0,0 +1,229 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MidiRouter.h"
+
+#include "ApplicationState.h"
+
+namespace
+{
+    constexpr int NUM_TYPES = 7;
+    
+    // the message type names of route filters, in the order of the channel voice status nibbles
+    const char* const TYPE_NAMES[NUM_TYPES + 1] = { "note", "note", "pp", "cc", "pc", "cp", "pb", "sys" };
+    
+    inline size_t getDispatchIndex(int type, int channel, int data1)
+    {
+        return ((size_t)type * 16 + (size_t)channel) * 128 + (size_t)data1;
+    }
+    
+    inline int getLowestRoute(uint64 mask)
+    {
+        return countNumberOfBits((mask & (~mask + 1)) - 1);
+    }
+}
+
+MidiRouter::MidiRouter() : dispatch_(8 * 16 * 128, 0)
+{
+}
+
+bool MidiRouter::hasRoutes() const
+{
+    return !routes_.isEmpty();
+}
+
+bool MidiRouter::parseFilter(const String& filter, const ApplicationState& state, BigInteger& types, BigInteger& channels, BigInteger& notes, BigInteger& controllers, String& error) const
+{
+    types.setRange(0, NUM_TYPES + 1, true);
+    channels.setRange(1, 16, true);
+    notes.setRange(0, 128, true);
+    controllers.setRange(0, 128, true);
+    
+    StringArray tokens;
+    tokens.addTokens(filter, true);
+    tokens.removeEmptyStrings(true);
+    if (tokens.isEmpty() || (tokens.size() == 1 && tokens[0] == "-"))
+    {
+        return true;
+    }
+    
+    for (int i = 0; i < tokens.size(); i += 2)
+    {
+        const String key = tokens[i];
+        if (i + 1 >= tokens.size())
+        {
+            error = "Missing value for route filter \"" + key + "\"";
+            return false;
+        }
+        
+        const String value = tokens[i + 1];
+        if (key.equalsIgnoreCase("type"))
+        {
+            types.clear();
+            StringArray names;
+            names.addTokens(value, ",", "");
+            for (auto& name : names)
+            {
+                bool found = false;
+                for (int t = 0; t <= NUM_TYPES; ++t)
+                {
+                    if (name.trim().equalsIgnoreCase(TYPE_NAMES[t]))
+                    {
+                        types.setBit(t);
+                        found = true;
+                    }
+                }
+                if (!found)
+                {
+                    error = "Unknown route message type \"" + name + "\", use note, pp, cc, pc, cp, pb or sys";
+                    return false;
+                }
+            }
+        }
+        else if (key.equalsIgnoreCase("ch"))
+        {
+            channels = state.asValueSet(value, false, 1, 16);
+        }
+        else if (key.equalsIgnoreCase("note"))
+        {
+            notes = state.asValueSet(value, true, 0, 127);
+        }
+        else if (key.equalsIgnoreCase("cc"))
+        {
+            controllers = state.asValueSet(value, false, 0, 127);
+        }
+        else
+        {
+            error = "Unknown route filter \"" + key + "\", use type, ch, note or cc";
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+bool MidiRouter::addRoute(const String& port, const String& filter, const String& transform, const ApplicationState& state, String& error)
+{
+    if (routes_.size() >= MAX_ROUTES)
+    {
+        error = "Only " + String(MAX_ROUTES) + " routes are supported";
+        return false;
+    }
+    
+    BigInteger types, channels, notes, controllers;
+    if (!parseFilter(filter, state, types, channels, notes, controllers, error))
+    {
+        return false;
+    }
+    
+    auto route = std::make_unique<Route>();
+    if (!route->transform_.parse(transform, state, error))
+    {
+        return false;
+    }
+    
+    route->output_ = BatchedMidiOutput::open(port);
+    if (route->output_ == nullptr)
+    {
+        // the output device already reported the problem
+        return false;
+    }
+    
+    const uint64 bit = (uint64)1 << routes_.size();
+    for (int t = 0; t < NUM_TYPES; ++t)
+    {
+        if (!types[t])
+        {
+            continue;
+        }
+        
+        // the first data byte only selects for the message types that have a note or controller
+        const BigInteger* data1 = nullptr;
+        if (t <= 2)
+        {
+            data1 = &notes;
+        }
+        else if (t == 3)
+        {
+            data1 = &controllers;
+        }
+        
+        for (int c = 0; c < 16; ++c)
+        {
+            if (!channels[c + 1])
+            {
+                continue;
+            }
+            for (int d = 0; d < 128; ++d)
+            {
+                if (data1 == nullptr || (*data1)[d])
+                {
+                    dispatch_[getDispatchIndex(t, c, d)] |= bit;
+                }
+            }
+        }
+    }
+    if (types[NUM_TYPES])
+    {
+        systemRoutes_ |= bit;
+    }
+    
+    routes_.add(route.release());
+    
+    return true;
+}
+
+void MidiRouter::dispatch(const MidiMessage& msg) const
+{
+    const uint8* data = msg.getRawData();
+    const int size = msg.getRawDataSize();
+    if (size < 1)
+    {
+        return;
+    }
+    
+    const uint8 status = data[0];
+    if (status >= 0xf0)
+    {
+        for (uint64 mask = systemRoutes_; mask != 0; mask &= mask - 1)
+        {
+            routes_.getUnchecked(getLowestRoute(mask))->output_->sendMessageNow(msg);
+        }
+        return;
+    }
+    
+    const int data1 = size > 1 ? (data[1] & 0x7f) : 0;
+    uint64 mask = dispatch_[getDispatchIndex((status >> 4) - 8, status & 0x0f, data1)];
+    for (; mask != 0; mask &= mask - 1)
+    {
+        auto* route = routes_.getUnchecked(getLowestRoute(mask));
+        if (route->transform_.isIdentity())
+        {
+            route->output_->sendMessageNow(msg);
+        }
+        else
+        {
+            uint8 transformed[3];
+            const int transformedSize = route->transform_.apply(data, size, transformed);
+            if (transformedSize > 0)
+            {
+                route->output_->sendMessageNow(MidiMessage(transformed, transformedSize, msg.getTimeStamp()));
+            }
+        }
+    }
+}
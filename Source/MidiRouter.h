@@ -0,0 +1,63 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "BatchedMidiOutput.h"
+#include "MessageTransform.h"
+
+class ApplicationState;
+
+/**
+ * Sends received MIDI 1.0 messages to any number of output ports, each with its own filter
+ * and transform.
+ *
+ * The filters of all the routes are compiled into a single dispatch table that has the set of
+ * matching routes for each message type, channel and first data byte. Finding the routes of a
+ * message is one lookup, however many routes there are.
+ */
+class MidiRouter
+{
+public:
+    static constexpr int MAX_ROUTES = 64;
+
+    MidiRouter();
+
+    bool addRoute(const String& port, const String& filter, const String& transform, const ApplicationState& state, String& error);
+    bool hasRoutes() const;
+    void dispatch(const MidiMessage& msg) const;
+
+private:
+    struct Route
+    {
+        std::shared_ptr<BatchedMidiOutput> output_;
+        MessageTransform transform_;
+    };
+
+    bool parseFilter(const String& filter, const ApplicationState& state, BigInteger& types, BigInteger& channels, BigInteger& notes, BigInteger& controllers, String& error) const;
+
+    OwnedArray<Route> routes_;
+
+    // route bits per channel voice status nibble, channel and first data byte
+    std::vector<uint64> dispatch_;
+    uint64 systemRoutes_    { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiRouter)
+};
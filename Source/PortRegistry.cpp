@@ -0,0 +1,59 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "PortRegistry.h"
+
+const String PortRegistry::OTHER = "other";
+
+PortRegistry::PortRegistry(int capacity) : capacity_(capacity)
+{
+    names_.add(String());
+}
+
+int PortRegistry::setPort(const String& name)
+{
+    if (names_.size() == 1 && names_[0].isEmpty())
+    {
+        names_.set(0, name);
+        return 0;
+    }
+    
+    const int index = names_.indexOf(name);
+    if (index >= 0)
+    {
+        return index;
+    }
+    
+    if (capacity_ == UNLIMITED || names_.size() < capacity_ - 1)
+    {
+        names_.add(name);
+        return names_.size() - 1;
+    }
+    
+    if (names_.size() < capacity_)
+    {
+        names_.add(OTHER);
+    }
+    return capacity_ - 1;
+}
+
+const StringArray& PortRegistry::getNames() const
+{
+    return names_;
+}
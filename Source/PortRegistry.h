@@ -0,0 +1,48 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Gives each input port name a small index, for the outputs that keep their state per port.
+ *
+ * Until the first port is known, index 0 belongs to an unnamed port that then takes the first
+ * name. With a limited capacity, the last index is kept for the ports that don't fit anymore,
+ * which are combined under the name "other" instead of being counted for another port. The
+ * registry isn't locked, its owner serializes the calls.
+ */
+class PortRegistry
+{
+public:
+    static constexpr int UNLIMITED = 0;
+    static const String OTHER;
+
+    PortRegistry(int capacity);
+
+    int setPort(const String& name);
+    const StringArray& getNames() const;
+
+private:
+    const int capacity_;
+    StringArray names_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PortRegistry)
+};
@@ -0,0 +1,676 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "RtpMidiInput.h"
+
+#include "BatchedMidiOutput.h"
+
+static const int MAX_PACKET_SIZE = 1500;
+static const uint32 PROTOCOL_VERSION = 2;
+static const uint8 RTP_MIDI_PAYLOAD_TYPE = 0x61;
+static const uint32 RECEIVER_FEEDBACK_INTERVAL_MS = 1000;
+
+RtpMidiInput::RtpMidiInput(MidiInputCallback& callback) : Thread("RTP-MIDI"), callback_(callback)
+{
+    ssrc_ = (uint32)Random::getSystemRandom().nextInt();
+}
+
+RtpMidiInput::ChannelState::ChannelState()
+{
+    // nothing is known about a channel until it's received
+    program_ = -1;
+    pitchBend_ = -1;
+    pressure_ = -1;
+    std::fill(std::begin(controllers_), std::end(controllers_), (int16)-1);
+    std::fill(std::begin(polyPressure_), std::end(polyPressure_), (int16)-1);
+    std::fill(std::begin(notes_), std::end(notes_), (uint8)0);
+}
+
+RtpMidiInput::~RtpMidiInput()
+{
+    stop();
+}
+
+bool RtpMidiInput::start(int port, const String& name)
+{
+    stop();
+
+    name_ = name;
+    controlSocket_ = std::make_unique<DatagramSocket>();
+    dataSocket_ = std::make_unique<DatagramSocket>();
+    if (!controlSocket_->bindToPort(port) || !dataSocket_->bindToPort(port + 1))
+    {
+        controlSocket_ = nullptr;
+        dataSocket_ = nullptr;
+        return false;
+    }
+
+    startThread(Priority::high);
+    return true;
+}
+
+void RtpMidiInput::stop()
+{
+    signalThreadShouldExit();
+    if (controlSocket_ != nullptr) controlSocket_->shutdown();
+    if (dataSocket_ != nullptr) dataSocket_->shutdown();
+    stopThread(1000);
+
+    controlSocket_ = nullptr;
+    dataSocket_ = nullptr;
+    sessions_.clear();
+}
+
+void RtpMidiInput::run()
+{
+    while (!threadShouldExit())
+    {
+        // MIDI data is time-critical, block on the data socket and only poll the control socket,
+        // all pending data is handled first so that a session doesn't end before its last packets
+        if (dataSocket_->waitUntilReady(true, 10) > 0)
+        {
+            // the outputs are written once for all the packets of a wake-up
+            BatchedMidiOutput::Burst burst;
+            while (readSocket(*dataSocket_, true));
+        }
+        if (controlSocket_->waitUntilReady(true, 0) > 0)
+        {
+            while (readSocket(*controlSocket_, false));
+        }
+
+        auto now = Time::getMillisecondCounter();
+        if (now - lastFeedback_ >= RECEIVER_FEEDBACK_INTERVAL_MS)
+        {
+            lastFeedback_ = now;
+            sendReceiverFeedback();
+        }
+    }
+}
+
+bool RtpMidiInput::readSocket(DatagramSocket& socket, bool isData)
+{
+    uint8 buffer[MAX_PACKET_SIZE];
+    String address;
+    int port = 0;
+    int size = socket.read(buffer, MAX_PACKET_SIZE, false, address, port);
+    if (size <= 0)
+    {
+        return false;
+    }
+
+    // stamp the packet as soon as possible after it arrived
+    double timestamp = Time::getMillisecondCounterHiRes() * 0.001;
+
+    if (size >= 4 && buffer[0] == 0xff && buffer[1] == 0xff)
+    {
+        handleSessionPacket(socket, isData, buffer, size, address, port);
+    }
+    else if (isData)
+    {
+        handleRtpPacket(buffer, size, timestamp);
+    }
+    
+    return true;
+}
+
+void RtpMidiInput::handleSessionPacket(DatagramSocket& socket, bool isData, const uint8* data, int size, const String& address, int port)
+{
+    char command[3] = { (char)data[2], (char)data[3], 0 };
+    String cmd(command);
+    if (cmd == "IN")
+    {
+        handleInvitation(socket, isData, data, size, address, port);
+    }
+    else if (cmd == "CK")
+    {
+        handleClockSync(socket, data, size, address, port);
+    }
+    else if (cmd == "BY" && size >= 16)
+    {
+        auto ssrc = ByteOrder::bigEndianInt(data + 12);
+        auto session = findSession(ssrc);
+        if (session != nullptr)
+        {
+            std::cerr << "RTP-MIDI session \"" << session->name_ << "\" ended" << std::endl;
+            sessions_.removeObject(session);
+        }
+    }
+}
+
+void RtpMidiInput::handleInvitation(DatagramSocket& socket, bool isData, const uint8* data, int size, const String& address, int port)
+{
+    if (size < 16 || ByteOrder::bigEndianInt(data + 4) != PROTOCOL_VERSION)
+    {
+        return;
+    }
+
+    auto token = ByteOrder::bigEndianInt(data + 8);
+    auto ssrc = ByteOrder::bigEndianInt(data + 12);
+
+    auto session = findSession(ssrc);
+    if (session == nullptr)
+    {
+        session = sessions_.add(new Session());
+        session->ssrc_ = ssrc;
+        auto name = (const char*)data + 16;
+        session->name_ = String::fromUTF8(name, (int)strnlen(name, (size_t)(size - 16)));
+    }
+    session->address_ = address;
+    if (isData)
+    {
+        session->dataPort_ = port;
+        if (!session->established_)
+        {
+            session->established_ = true;
+            std::cerr << "RTP-MIDI session \"" << session->name_ << "\" established with " << address << std::endl;
+        }
+    }
+    else
+    {
+        session->controlPort_ = port;
+    }
+
+    MemoryOutputStream reply;
+    reply.writeShortBigEndian((short)0xffff);
+    reply.write("OK", 2);
+    reply.writeIntBigEndian((int)PROTOCOL_VERSION);
+    reply.writeIntBigEndian((int)token);
+    reply.writeIntBigEndian((int)ssrc_);
+    reply.write(name_.toRawUTF8(), name_.getNumBytesAsUTF8());
+    reply.writeByte(0);
+    socket.write(address, port, reply.getData(), (int)reply.getDataSize());
+}
+
+void RtpMidiInput::handleClockSync(DatagramSocket& socket, const uint8* data, int size, const String& address, int port)
+{
+    if (size < 36)
+    {
+        return;
+    }
+
+    // the initiator starts the exchange with count 0, we answer with count 1
+    // and it concludes with count 2, which needs no further answer
+    auto count = data[8];
+    if (count == 0)
+    {
+        MemoryOutputStream reply;
+        reply.writeShortBigEndian((short)0xffff);
+        reply.write("CK", 2);
+        reply.writeIntBigEndian((int)ssrc_);
+        reply.writeByte(1);
+        reply.writeByte(0);
+        reply.writeShortBigEndian(0);
+        reply.write(data + 12, 8);
+        reply.writeInt64BigEndian(getSessionTime());
+        reply.writeInt64BigEndian(0);
+        socket.write(address, port, reply.getData(), (int)reply.getDataSize());
+    }
+}
+
+void RtpMidiInput::handleRtpPacket(const uint8* data, int size, double timestamp)
+{
+    if (size < 13 || (data[0] & 0xc0) != 0x80 || (data[1] & 0x7f) != RTP_MIDI_PAYLOAD_TYPE)
+    {
+        return;
+    }
+
+    auto sequence = ByteOrder::bigEndianShort(data + 2);
+    auto session = findSession(ByteOrder::bigEndianInt(data + 8));
+    if (session == nullptr || !session->established_)
+    {
+        return;
+    }
+
+    // skip the CSRC list and any header extension
+    int offset = 12 + (data[0] & 0x0f) * 4;
+    if ((data[0] & 0x10) != 0 && offset + 4 <= size)
+    {
+        offset += 4 + ByteOrder::bigEndianShort(data + offset + 2) * 4;
+    }
+    if (offset >= size)
+    {
+        return;
+    }
+
+    // MIDI command section header
+    auto flags = data[offset];
+    int length = flags & 0x0f;
+    int header = 1;
+    if ((flags & 0x80) != 0)
+    {
+        if (offset + 1 >= size)
+        {
+            return;
+        }
+        length = (length << 8) | data[offset + 1];
+        header = 2;
+    }
+    auto has_journal = (flags & 0x40) != 0;
+    auto first_has_delta = (flags & 0x20) != 0;
+
+    const uint8* commands = data + offset + header;
+    int available = size - offset - header;
+    length = jmin(length, available);
+
+    // duplicates and packets that arrive after a later one are dropped, their commands are
+    // already covered by the journal of the later packet
+    auto delta = (int16)(uint16)(sequence - session->expectedSequence_);
+    if (session->hasSequence_ && delta < 0)
+    {
+        return;
+    }
+
+    // when packets got lost, use the recovery journal of this packet to restore the state
+    auto lost = session->hasSequence_ && delta > 0;
+    if (lost && has_journal)
+    {
+        handleJournal(*session, commands + length, available - length, timestamp);
+    }
+    session->hasSequence_ = true;
+    session->expectedSequence_ = (uint16)(sequence + 1);
+    session->lastSequence_ = sequence;
+
+    handleCommandSection(*session, commands, length, first_has_delta, timestamp);
+}
+
+void RtpMidiInput::handleCommandSection(Session& session, const uint8* data, int size, bool firstHasDelta, double timestamp)
+{
+    int pos = 0;
+    uint8 running_status = 0;
+    double delta_time = 0.0;
+    bool first = true;
+
+    while (pos < size)
+    {
+        if (!first || firstHasDelta)
+        {
+            // variable length delta time in RTP timestamp units, which is 10 kHz for AppleMIDI
+            uint32 delta = 0;
+            for (int i = 0; i < 4 && pos < size; ++i)
+            {
+                auto b = data[pos++];
+                delta = (delta << 7) | (b & 0x7f);
+                if ((b & 0x80) == 0) break;
+            }
+            delta_time += delta * 0.0001;
+        }
+        first = false;
+        if (pos >= size)
+        {
+            break;
+        }
+
+        uint8 status = data[pos];
+        if (status >= 0x80)
+        {
+            ++pos;
+            if (status < 0xf0)
+            {
+                running_status = status;
+            }
+            else if (status < 0xf8)
+            {
+                running_status = 0;
+            }
+        }
+        else if (running_status != 0)
+        {
+            status = running_status;
+        }
+        else
+        {
+            // data bytes without a status, the rest of the section can't be interpreted
+            break;
+        }
+
+        if (status == 0xf0 || status == 0xf7)
+        {
+            // a complete SysEx or a segment of a SysEx that's spread over several commands
+            if (status == 0xf0)
+            {
+                session.sysex_.reset();
+                session.sysex_.append(&status, 1);
+                session.sysexActive_ = true;
+            }
+
+            while (pos < size)
+            {
+                auto b = data[pos++];
+                if (b >= 0xf8)
+                {
+                    deliver(&b, 1, timestamp + delta_time);
+                }
+                else if (b == 0xf7)
+                {
+                    if (session.sysexActive_)
+                    {
+                        session.sysex_.append(&b, 1);
+                        deliver((const uint8*)session.sysex_.getData(), (int)session.sysex_.getSize(), timestamp + delta_time);
+                    }
+                    session.sysexActive_ = false;
+                    break;
+                }
+                else if (b == 0xf0)
+                {
+                    // the SysEx continues in a later command
+                    break;
+                }
+                else if (b == 0xf4)
+                {
+                    // the sender cancelled the SysEx
+                    session.sysexActive_ = false;
+                    break;
+                }
+                else if (b >= 0x80)
+                {
+                    session.sysexActive_ = false;
+                    --pos;
+                    break;
+                }
+                else if (session.sysexActive_)
+                {
+                    session.sysex_.append(&b, 1);
+                }
+            }
+        }
+        else
+        {
+            int length = MidiMessage::getMessageLengthFromFirstByte(status);
+            uint8 msg[3] = { status, 0, 0 };
+            for (int i = 1; i < length; ++i)
+            {
+                if (pos >= size) return;
+                msg[i] = data[pos++] & 0x7f;
+            }
+            track(session, msg, length);
+            deliver(msg, length, timestamp + delta_time);
+        }
+    }
+}
+
+void RtpMidiInput::handleJournal(Session& session, const uint8* data, int size, double timestamp)
+{
+    if (size < 3)
+    {
+        return;
+    }
+
+    auto header = data[0];
+    int pos = 3;
+
+    // system journal, not used for recovery
+    if ((header & 0x40) != 0)
+    {
+        if (pos + 2 > size) return;
+        pos += ((data[pos] & 0x03) << 8) | data[pos + 1];
+    }
+
+    // channel journals
+    if ((header & 0x20) != 0)
+    {
+        int channels = (header & 0x0f) + 1;
+        for (int i = 0; i < channels; ++i)
+        {
+            if (pos + 3 > size) return;
+            int channel = (data[pos] >> 3) & 0x0f;
+            int length = ((data[pos] & 0x03) << 8) | data[pos + 1];
+            if (length < 3 || pos + length > size) return;
+            handleChannelJournal(session, channel, data[pos + 2], data + pos + 3, length - 3, timestamp);
+            pos += length;
+        }
+    }
+}
+
+void RtpMidiInput::handleChannelJournal(Session& session, int channel, uint8 chapters, const uint8* data, int size, double timestamp)
+{
+    // the journal has the latest state of the sender, only the differences with what was
+    // received are sent, so that recovery doesn't repeat notes or make controllers jump
+    auto& state = session.channels_[channel];
+    int pos = 0;
+    auto send = [this, &session, timestamp] (uint8 b0, uint8 b1, uint8 b2)
+    {
+        uint8 msg[3] = { b0, b1, b2 };
+        int length = MidiMessage::getMessageLengthFromFirstByte(b0);
+        track(session, msg, length);
+        deliver(msg, length, timestamp);
+    };
+
+    // chapter P: program change
+    if ((chapters & 0x80) != 0)
+    {
+        if (pos + 3 > size) return;
+        auto program = data[pos] & 0x7f;
+        auto bank_changed = false;
+        if ((data[pos + 1] & 0x80) != 0)
+        {
+            auto msb = data[pos + 1] & 0x7f;
+            auto lsb = data[pos + 2] & 0x7f;
+            bank_changed = state.controllers_[0] != msb || state.controllers_[32] != lsb;
+            if (bank_changed)
+            {
+                send((uint8)(0xb0 | channel), 0, (uint8)msb);
+                send((uint8)(0xb0 | channel), 32, (uint8)lsb);
+            }
+        }
+        if (bank_changed || state.program_ != program)
+        {
+            send((uint8)(0xc0 | channel), (uint8)program, 0);
+        }
+        pos += 3;
+    }
+
+    // chapter C: control change
+    if ((chapters & 0x40) != 0)
+    {
+        if (pos + 1 > size) return;
+        int logs = (data[pos] & 0x7f) + 1;
+        ++pos;
+        for (int i = 0; i < logs; ++i, pos += 2)
+        {
+            if (pos + 2 > size) return;
+            // only plain values, toggle and count tools can't be restored meaningfully
+            auto number = data[pos] & 0x7f;
+            auto value = data[pos + 1] & 0x7f;
+            if ((data[pos + 1] & 0x80) == 0 && state.controllers_[number] != value)
+            {
+                send((uint8)(0xb0 | channel), (uint8)number, (uint8)value);
+            }
+        }
+    }
+
+    // chapter M: parameter system, skipped since chapter C already restores the controllers
+    if ((chapters & 0x20) != 0)
+    {
+        if (pos + 2 > size) return;
+        pos += ((data[pos] & 0x03) << 8) | data[pos + 1];
+    }
+
+    // chapter W: pitch wheel
+    if ((chapters & 0x10) != 0)
+    {
+        if (pos + 2 > size) return;
+        auto lsb = data[pos] & 0x7f;
+        auto msb = data[pos + 1] & 0x7f;
+        if (state.pitchBend_ != (lsb | (msb << 7)))
+        {
+            send((uint8)(0xe0 | channel), (uint8)lsb, (uint8)msb);
+        }
+        pos += 2;
+    }
+
+    // chapter N: note off and note on
+    if ((chapters & 0x08) != 0)
+    {
+        if (pos + 2 > size) return;
+        int logs = data[pos] & 0x7f;
+        int low = (data[pos + 1] >> 4) & 0x0f;
+        int high = data[pos + 1] & 0x0f;
+        if (logs == 127 && low == 15 && high == 0)
+        {
+            logs = 128;
+        }
+        pos += 2;
+
+        for (int i = 0; i < logs; ++i, pos += 2)
+        {
+            if (pos + 2 > size) return;
+            // only play notes that the sender marked as still worth playing and that aren't
+            // sounding already
+            auto note = data[pos] & 0x7f;
+            if ((data[pos + 1] & 0x80) != 0 && state.notes_[note] == 0)
+            {
+                send((uint8)(0x90 | channel), (uint8)note, data[pos + 1] & 0x7f);
+            }
+        }
+
+        if (low <= high)
+        {
+            for (int octet = low; octet <= high; ++octet, ++pos)
+            {
+                if (pos >= size) return;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    auto note = octet * 8 + bit;
+                    if ((data[pos] & (0x80 >> bit)) != 0 && state.notes_[note] != 0)
+                    {
+                        send((uint8)(0x80 | channel), (uint8)note, 0);
+                    }
+                }
+            }
+        }
+    }
+
+    // chapter E: note command extras, skipped
+    if ((chapters & 0x04) != 0)
+    {
+        if (pos + 1 > size) return;
+        pos += 1 + ((data[pos] & 0x7f) + 1) * 2;
+    }
+
+    // chapter T: channel pressure
+    if ((chapters & 0x02) != 0)
+    {
+        if (pos + 1 > size) return;
+        auto pressure = data[pos] & 0x7f;
+        if (state.pressure_ != pressure)
+        {
+            send((uint8)(0xd0 | channel), (uint8)pressure, 0);
+        }
+        pos += 1;
+    }
+
+    // chapter A: poly pressure
+    if ((chapters & 0x01) != 0)
+    {
+        if (pos + 1 > size) return;
+        int logs = (data[pos] & 0x7f) + 1;
+        ++pos;
+        for (int i = 0; i < logs; ++i, pos += 2)
+        {
+            if (pos + 2 > size) return;
+            auto note = data[pos] & 0x7f;
+            auto pressure = data[pos + 1] & 0x7f;
+            if (state.polyPressure_[note] != pressure)
+            {
+                send((uint8)(0xa0 | channel), (uint8)note, (uint8)pressure);
+            }
+        }
+    }
+}
+
+void RtpMidiInput::sendReceiverFeedback()
+{
+    // let the senders know which packets arrived, so that they can trim their journals
+    for (auto session : sessions_)
+    {
+        if (!session->established_ || !session->hasSequence_ || session->controlPort_ == 0)
+        {
+            continue;
+        }
+
+        MemoryOutputStream feedback;
+        feedback.writeShortBigEndian((short)0xffff);
+        feedback.write("RS", 2);
+        feedback.writeIntBigEndian((int)ssrc_);
+        feedback.writeShortBigEndian((short)session->lastSequence_);
+        feedback.writeShortBigEndian(0);
+        controlSocket_->write(session->address_, session->controlPort_, feedback.getData(), (int)feedback.getDataSize());
+    }
+}
+
+void RtpMidiInput::deliver(const uint8* data, int size, double timestamp)
+{
+    MidiMessage msg(data, size, timestamp);
+    callback_.handleIncomingMidiMessage(nullptr, msg);
+}
+
+void RtpMidiInput::track(Session& session, const uint8* data, int size)
+{
+    if (size < 2 || data[0] < 0x80 || data[0] >= 0xf0)
+    {
+        return;
+    }
+
+    auto& state = session.channels_[data[0] & 0x0f];
+    auto data1 = data[1] & 0x7f;
+    auto data2 = size > 2 ? data[2] & 0x7f : 0;
+    switch (data[0] & 0xf0)
+    {
+        case 0x80:
+            state.notes_[data1] = 0;
+            break;
+        case 0x90:
+            state.notes_[data1] = (uint8)data2;
+            break;
+        case 0xa0:
+            state.polyPressure_[data1] = (int16)data2;
+            break;
+        case 0xb0:
+            state.controllers_[data1] = (int16)data2;
+            break;
+        case 0xc0:
+            state.program_ = (int16)data1;
+            break;
+        case 0xd0:
+            state.pressure_ = (int16)data1;
+            break;
+        case 0xe0:
+            state.pitchBend_ = (int16)(data1 | (data2 << 7));
+            break;
+        default:
+            break;
+    }
+}
+
+RtpMidiInput::Session* RtpMidiInput::findSession(uint32 ssrc)
+{
+    for (auto session : sessions_)
+    {
+        if (session->ssrc_ == ssrc)
+        {
+            return session;
+        }
+    }
+    return nullptr;
+}
+
+int64 RtpMidiInput::getSessionTime()
+{
+    // AppleMIDI clock synchronization uses units of 100 microseconds
+    return (int64)(Time::getMillisecondCounterHiRes() * 10.0);
+}
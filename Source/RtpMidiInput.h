@@ -0,0 +1,96 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Listens for RTP-MIDI (RFC 6295) network sessions using the AppleMIDI session protocol.
+ *
+ * The control port receives invitations and the data port, at control port + 1, receives
+ * clock synchronization and the RTP-MIDI packets. Decoded MIDI commands are delivered to the
+ * callback from the listener thread, time stamped when the packet was received.
+ */
+class RtpMidiInput : public Thread
+{
+public:
+    RtpMidiInput(MidiInputCallback& callback);
+    ~RtpMidiInput() override;
+
+    bool start(int port, const String& name);
+    void stop();
+
+private:
+    // what has been received on a channel, so that recovery only sends what differs
+    struct ChannelState
+    {
+        ChannelState();
+
+        int16 program_;
+        int16 controllers_[128];
+        int16 pitchBend_;
+        int16 pressure_;
+        int16 polyPressure_[128];
+        uint8 notes_[128];
+    };
+
+    struct Session
+    {
+        uint32 ssrc_            { 0 };
+        String name_;
+        String address_;
+        int controlPort_        { 0 };
+        int dataPort_           { 0 };
+        bool established_       { false };
+        bool hasSequence_       { false };
+        uint16 expectedSequence_{ 0 };
+        uint16 lastSequence_    { 0 };
+        bool sysexActive_       { false };
+        MemoryBlock sysex_;
+        ChannelState channels_[16];
+    };
+
+    void run() override;
+
+    bool readSocket(DatagramSocket& socket, bool isData);
+    void handleSessionPacket(DatagramSocket& socket, bool isData, const uint8* data, int size, const String& address, int port);
+    void handleInvitation(DatagramSocket& socket, bool isData, const uint8* data, int size, const String& address, int port);
+    void handleClockSync(DatagramSocket& socket, const uint8* data, int size, const String& address, int port);
+    void handleRtpPacket(const uint8* data, int size, double timestamp);
+    void handleCommandSection(Session& session, const uint8* data, int size, bool firstHasDelta, double timestamp);
+    void handleJournal(Session& session, const uint8* data, int size, double timestamp);
+    void handleChannelJournal(Session& session, int channel, uint8 chapters, const uint8* data, int size, double timestamp);
+    void sendReceiverFeedback();
+    void deliver(const uint8* data, int size, double timestamp);
+    static void track(Session& session, const uint8* data, int size);
+
+    Session* findSession(uint32 ssrc);
+    static int64 getSessionTime();
+
+    MidiInputCallback& callback_;
+    String name_;
+    uint32 ssrc_            { 0 };
+
+    std::unique_ptr<DatagramSocket> controlSocket_;
+    std::unique_ptr<DatagramSocket> dataSocket_;
+    OwnedArray<Session> sessions_;
+    uint32 lastFeedback_    { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RtpMidiInput)
+};
@@ -27,6 +27,7 @@ ScriptMidiMessageClass::ScriptMidiMessageClass(ApplicationState& state) : applic
     setMethod("getRawDataSize", getRawDataSize);
     setMethod("rawDataSize", getRawDataSize);
     setMethod("output", output);
+    setMethod("record", record);
 
     setMethod("getDescription", getDescription);
     setMethod("description", getDescription);
@@ -86,6 +87,19 @@ ScriptMidiMessageClass::ScriptMidiMessageClass(ApplicationState& state) : applic
     setMethod("controllerNumber", getControllerNumber);
     setMethod("getControllerValue", getControllerValue);
     setMethod("controllerValue", getControllerValue);
+    setMethod("getLastControllerValue", getLastControllerValue);
+    setMethod("lastControllerValue", getLastControllerValue);
+    setMethod("isController14Bit", isController14Bit);
+    setMethod("getController14BitNumber", getController14BitNumber);
+    setMethod("controller14BitNumber", getController14BitNumber);
+    setMethod("getController14BitValue", getController14BitValue);
+    setMethod("controller14BitValue", getController14BitValue);
+    setMethod("isNrpn", isNrpn);
+    setMethod("isRpn", isRpn);
+    setMethod("getParameterNumber", getParameterNumber);
+    setMethod("parameterNumber", getParameterNumber);
+    setMethod("getParameterValue", getParameterValue);
+    setMethod("parameterValue", getParameterValue);
     
     setMethod("isAllNotesOff", isAllNotesOff);
     setMethod("isAllSoundOff", isAllSoundOff);
@@ -145,6 +159,13 @@ var ScriptMidiMessageClass::getChannelPressureValue(const var::NativeFunctionArg
 var ScriptMidiMessageClass::isController(const var::NativeFunctionArgs& a)                      { return getMsg(a).isController(); }
 var ScriptMidiMessageClass::getControllerNumber(const var::NativeFunctionArgs& a)               { return getMsg(a).getControllerNumber(); }
 var ScriptMidiMessageClass::getControllerValue(const var::NativeFunctionArgs& a)                { return getMsg(a).getControllerValue(); }
+var ScriptMidiMessageClass::isController14Bit(const var::NativeFunctionArgs& a)                 { return getDisplayState(a).controlChange14bit; }
+var ScriptMidiMessageClass::getController14BitNumber(const var::NativeFunctionArgs& a)          { return getDisplayState(a).controlChange14bitNumber; }
+var ScriptMidiMessageClass::getController14BitValue(const var::NativeFunctionArgs& a)           { return getDisplayState(a).controlChange14bitValue; }
+var ScriptMidiMessageClass::isNrpn(const var::NativeFunctionArgs& a)                            { return getDisplayState(a).parameter && getDisplayState(a).parameterIsNrpn; }
+var ScriptMidiMessageClass::isRpn(const var::NativeFunctionArgs& a)                             { return getDisplayState(a).parameter && !getDisplayState(a).parameterIsNrpn; }
+var ScriptMidiMessageClass::getParameterNumber(const var::NativeFunctionArgs& a)                { return getDisplayState(a).parameterNumber; }
+var ScriptMidiMessageClass::getParameterValue(const var::NativeFunctionArgs& a)                 { return getDisplayState(a).parameterValue; }
 
 var ScriptMidiMessageClass::isAllNotesOff(const var::NativeFunctionArgs& a)                     { return getMsg(a).isAllNotesOff(); }
 var ScriptMidiMessageClass::isAllSoundOff(const var::NativeFunctionArgs& a)                     { return getMsg(a).isAllSoundOff(); }
@@ -192,3 +213,27 @@ var ScriptMidiMessageClass::output(const var::NativeFunctionArgs& a)
     
     return true;
 }
+
+var ScriptMidiMessageClass::record(const var::NativeFunctionArgs& a)
+{
+    getApplicationState(a).triggerRecorder();
+    
+    return true;
+}
+
+var ScriptMidiMessageClass::getLastControllerValue(const var::NativeFunctionArgs& a)
+{
+    if (a.numArguments < 2)
+    {
+        return var::undefined();
+    }
+    
+    int channel = (int)a.arguments[0];
+    int number = (int)a.arguments[1];
+    if (channel < 1 || channel > 16 || number < 0 || number > 127)
+    {
+        return var::undefined();
+    }
+    
+    return getApplicationState(a).getControllerState().get(channel - 1, number);
+}
@@ -39,6 +39,7 @@ public:
     static var getRawData(const var::NativeFunctionArgs&);
     static var getRawDataSize(const var::NativeFunctionArgs&);
     static var output(const var::NativeFunctionArgs&);
+    static var record(const var::NativeFunctionArgs&);
     
     static var getDescription(const var::NativeFunctionArgs&);
     
@@ -78,6 +79,14 @@ public:
     static var isController(const var::NativeFunctionArgs&);
     static var getControllerNumber(const var::NativeFunctionArgs&);
     static var getControllerValue(const var::NativeFunctionArgs&);
+    static var getLastControllerValue(const var::NativeFunctionArgs&);
+    static var isController14Bit(const var::NativeFunctionArgs&);
+    static var getController14BitNumber(const var::NativeFunctionArgs&);
+    static var getController14BitValue(const var::NativeFunctionArgs&);
+    static var isNrpn(const var::NativeFunctionArgs&);
+    static var isRpn(const var::NativeFunctionArgs&);
+    static var getParameterNumber(const var::NativeFunctionArgs&);
+    static var getParameterValue(const var::NativeFunctionArgs&);
 
     static var isAllNotesOff(const var::NativeFunctionArgs&);
     static var isAllSoundOff(const var::NativeFunctionArgs&);
@@ -0,0 +1,139 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SharedMemoryPublisher.h"
+
+#if (JUCE_LINUX || JUCE_MAC)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+SharedMemoryPublisher::SharedMemoryPublisher()
+{
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+    stop();
+}
+
+bool SharedMemoryPublisher::isActive() const
+{
+    return header_ != nullptr;
+}
+
+bool SharedMemoryPublisher::start(const String& name, String& error)
+{
+#if (JUCE_LINUX || JUCE_MAC)
+    stop();
+    
+    // shared memory object names are a single path component that starts with a slash
+    name_ = name.startsWithChar('/') ? name : "/" + name;
+    
+    length_ = sizeof(receivemidi_shm_header) + NUM_SLOTS * sizeof(receivemidi_shm_slot);
+    const int fd = shm_open(name_.toRawUTF8(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)length_) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        error = "Couldn't create shared memory \"" + name_ + "\"";
+        return false;
+    }
+    
+    memory_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory_ == MAP_FAILED)
+    {
+        memory_ = nullptr;
+        shm_unlink(name_.toRawUTF8());
+        error = "Couldn't map shared memory \"" + name_ + "\"";
+        return false;
+    }
+    
+    // readers of an earlier run that didn't stop cleanly detect the restart by the generation
+    auto* header = (receivemidi_shm_header*)memory_;
+    const uint64 previous = header->magic == RECEIVEMIDI_SHM_MAGIC ? __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE) : 0;
+    __atomic_store_n(&header->generation, (uint64)0, __ATOMIC_RELEASE);
+    
+    // all slots start out as not written
+    slots_ = (receivemidi_shm_slot*)(header + 1);
+    for (uint32 i = 0; i < NUM_SLOTS; ++i)
+    {
+        __atomic_store_n(&slots_[i].sequence, RECEIVEMIDI_SHM_WRITING, __ATOMIC_RELAXED);
+    }
+    header->slot_count = NUM_SLOTS;
+    header->slot_size = sizeof(receivemidi_shm_slot);
+    header->version = RECEIVEMIDI_SHM_VERSION;
+    sequence_ = 0;
+    __atomic_store_n(&header->write_sequence, sequence_, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->magic, RECEIVEMIDI_SHM_MAGIC, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->generation, jmax(previous + 1, (uint64)Time::currentTimeMillis()), __ATOMIC_RELEASE);
+    
+    // message timestamps are based on the high resolution counter, they're written as
+    // milliseconds since the epoch
+    timeOffset_ = (double)Time::currentTimeMillis() - Time::getMillisecondCounterHiRes();
+    
+    header_ = header;
+    return true;
+#else
+    ignoreUnused(name);
+    error = "Shared memory publishing is only supported on Linux and macOS";
+    return false;
+#endif
+}
+
+void SharedMemoryPublisher::stop()
+{
+#if (JUCE_LINUX || JUCE_MAC)
+    if (memory_ != nullptr)
+    {
+        // readers that still have the ring mapped keep it until they close it, the cleared
+        // generation tells them to open it again
+        __atomic_store_n(&header_->generation, (uint64)0, __ATOMIC_RELEASE);
+        munmap(memory_, length_);
+        shm_unlink(name_.toRawUTF8());
+        memory_ = nullptr;
+        header_ = nullptr;
+        slots_ = nullptr;
+    }
+#endif
+}
+
+void SharedMemoryPublisher::publish(const uint8* data, int size, double timestamp)
+{
+#if (JUCE_LINUX || JUCE_MAC)
+    receivemidi_shm_slot& slot = slots_[sequence_ & (NUM_SLOTS - 1)];
+    
+    // readers that copy the slot while it's written see that its sequence changed
+    __atomic_store_n(&slot.sequence, RECEIVEMIDI_SHM_WRITING, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    
+    slot.timestamp = timestamp * 1000.0 + timeOffset_;
+    slot.size = (uint32)size;
+    memcpy(slot.data, data, (size_t)jmin(size, (int)RECEIVEMIDI_SHM_SLOT_DATA));
+    
+    __atomic_store_n(&slot.sequence, sequence_, __ATOMIC_RELEASE);
+    sequence_ += 1;
+    __atomic_store_n(&header_->write_sequence, sequence_, __ATOMIC_RELEASE);
+#else
+    ignoreUnused(data, size, timestamp);
+#endif
+}
@@ -0,0 +1,58 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#define RECEIVEMIDI_SHM_NO_READER
+#include "SharedMemoryRing.h"
+
+/**
+ * Publishes the received MIDI messages into a POSIX shared memory ring, so that local processes
+ * can read them with the reader in SharedMemoryRing.h, without any system calls or copies on
+ * the side of ReceiveMIDI.
+ *
+ * Publishing a message only writes its slot and two sequence numbers, readers never hold up
+ * the receiving thread.
+ */
+class SharedMemoryPublisher
+{
+public:
+    static constexpr uint32 NUM_SLOTS = 65536;
+
+    SharedMemoryPublisher();
+    ~SharedMemoryPublisher();
+
+    bool start(const String& name, String& error);
+    void stop();
+    bool isActive() const;
+
+    void publish(const uint8* data, int size, double timestamp);
+
+private:
+    String name_;
+    void* memory_                       { nullptr };
+    size_t length_                      { 0 };
+    receivemidi_shm_header* header_     { nullptr };
+    receivemidi_shm_slot* slots_        { nullptr };
+    uint64 sequence_                    { 0 };
+    double timeOffset_                  { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SharedMemoryPublisher)
+};
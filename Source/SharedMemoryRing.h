@@ -0,0 +1,205 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RECEIVEMIDI_SHARED_MEMORY_RING_H
+#define RECEIVEMIDI_SHARED_MEMORY_RING_H
+
+/*
+ * Layout of the POSIX shared memory ring that ReceiveMIDI publishes the received MIDI messages
+ * to with the "shm" command, and a reader for it that can be copied into C and C++ programs.
+ *
+ * ReceiveMIDI is the single writer. Each message is written to the next fixed size slot and
+ * tagged with its sequence number, which readers check before and after copying a slot. Readers
+ * never block the writer, a reader that falls more than a ring behind detects the overrun
+ * through the sequence numbers and continues with the oldest message that's still available.
+ * Each run of the writer has its own generation, readers notice when the writer stopped or
+ * restarted and need to open the ring again.
+ * Messages that don't fit in a slot, like most SysEx messages, keep their full size but only
+ * their first bytes.
+ *
+ *     receivemidi_shm_reader reader;
+ *     receivemidi_shm_event event;
+ *     if (receivemidi_shm_open(&reader, "/receivemidi") == 0)
+ *     {
+ *         for (;;)
+ *         {
+ *             uint64_t lost = 0;
+ *             int result = receivemidi_shm_read(&reader, &event, &lost);
+ *             ...
+ *         }
+ *     }
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#define RECEIVEMIDI_SHM_MAGIC       0x494d5352u
+#define RECEIVEMIDI_SHM_VERSION     2u
+#define RECEIVEMIDI_SHM_SLOT_DATA   12u
+
+/* sequence of a slot that is being written */
+#define RECEIVEMIDI_SHM_WRITING     UINT64_MAX
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;            /* a power of two */
+    uint32_t slot_size;
+    uint64_t write_sequence;        /* sequence of the next message, written atomically */
+    uint64_t generation;            /* changes for each run of the writer, 0 once it stopped */
+    uint8_t padding[32];
+} receivemidi_shm_header;
+
+typedef struct
+{
+    uint64_t sequence;              /* written atomically */
+    double timestamp;               /* milliseconds since the epoch */
+    uint32_t size;                  /* full size of the message */
+    uint8_t data[RECEIVEMIDI_SHM_SLOT_DATA];
+} receivemidi_shm_slot;
+
+typedef struct
+{
+    uint64_t sequence;
+    double timestamp;
+    uint32_t size;                  /* full size of the message, can be larger than the data */
+    uint8_t data[RECEIVEMIDI_SHM_SLOT_DATA];
+} receivemidi_shm_event;
+
+#if !defined(RECEIVEMIDI_SHM_NO_READER) && !defined(_WIN32)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct
+{
+    const receivemidi_shm_header* header;
+    const receivemidi_shm_slot* slots;
+    size_t length;
+    uint64_t generation;
+    uint64_t next;
+} receivemidi_shm_reader;
+
+/* maps the ring read-only and starts reading at the next message, returns 0 on success */
+static inline int receivemidi_shm_open(receivemidi_shm_reader* reader, const char* name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat info;
+    void* memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(receivemidi_shm_header))
+    {
+        memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const receivemidi_shm_header* header = (const receivemidi_shm_header*)memory;
+    if (header->magic != RECEIVEMIDI_SHM_MAGIC || header->version != RECEIVEMIDI_SHM_VERSION ||
+        header->slot_size != sizeof(receivemidi_shm_slot) ||
+        sizeof(receivemidi_shm_header) + (size_t)header->slot_count * sizeof(receivemidi_shm_slot) > (size_t)info.st_size ||
+        __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE) == 0)
+    {
+        munmap(memory, (size_t)info.st_size);
+        return -1;
+    }
+
+    reader->header = header;
+    reader->slots = (const receivemidi_shm_slot*)(header + 1);
+    reader->length = (size_t)info.st_size;
+    reader->generation = __atomic_load_n(&header->generation, __ATOMIC_ACQUIRE);
+    reader->next = __atomic_load_n(&header->write_sequence, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+static inline void receivemidi_shm_close(receivemidi_shm_reader* reader)
+{
+    if (reader->header != NULL)
+    {
+        munmap((void*)reader->header, reader->length);
+        reader->header = NULL;
+    }
+}
+
+/*
+ * Reads the next message without blocking. Returns 1 when a message was read, 0 when there's
+ * no new message yet and -1 after an overrun, in which case lost is set to the number of
+ * messages that were overwritten before they could be read, and the next read continues with
+ * the oldest message that's still available. Returns -2 when the writer stopped or restarted,
+ * the reader then needs to be closed and opened again.
+ */
+static inline int receivemidi_shm_read(receivemidi_shm_reader* reader, receivemidi_shm_event* event, uint64_t* lost)
+{
+    const receivemidi_shm_header* header = reader->header;
+    const uint64_t written = __atomic_load_n(&header->write_sequence, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&header->generation, __ATOMIC_ACQUIRE) != reader->generation || written < reader->next)
+    {
+        return -2;
+    }
+    if (reader->next == written)
+    {
+        return 0;
+    }
+
+    if (written - reader->next <= header->slot_count)
+    {
+        const receivemidi_shm_slot* slot = &reader->slots[reader->next & (header->slot_count - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) == reader->next)
+        {
+            event->timestamp = slot->timestamp;
+            event->size = slot->size;
+            memcpy(event->data, slot->data, sizeof(event->data));
+
+            /* the copy is only valid when the writer didn't reuse the slot in the meantime */
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == reader->next)
+            {
+                event->sequence = reader->next;
+                reader->next += 1;
+                return 1;
+            }
+        }
+    }
+
+    /* the writer lapped the reader, continue with the oldest slot that can't be reused yet */
+    const uint64_t latest = __atomic_load_n(&header->write_sequence, __ATOMIC_ACQUIRE);
+    const uint64_t oldest = latest > header->slot_count / 2 ? latest - header->slot_count / 2 : 0;
+    if (lost != NULL)
+    {
+        *lost = oldest > reader->next ? oldest - reader->next : 0;
+    }
+    if (oldest > reader->next)
+    {
+        reader->next = oldest;
+    }
+    return -1;
+}
+
+#endif
+
+#endif
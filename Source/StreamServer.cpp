@@ -0,0 +1,477 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "StreamServer.h"
+
+#if JUCE_LINUX
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+bool StreamServer::parseFormat(const String& name, Format& format)
+{
+    if (name.equalsIgnoreCase("raw"))
+    {
+        format = RAW;
+    }
+    else if (name.equalsIgnoreCase("text"))
+    {
+        format = TEXT;
+    }
+    else
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+bool StreamServer::parsePolicy(const String& name, SlowClientPolicy& policy)
+{
+    if (name.equalsIgnoreCase("disconnect"))
+    {
+        policy = DISCONNECT;
+    }
+    else if (name.equalsIgnoreCase("drop"))
+    {
+        policy = DROP;
+    }
+    else
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+StreamServer::StreamServer() : Thread("StreamServer")
+{
+}
+
+StreamServer::~StreamServer()
+{
+    stop();
+}
+
+bool StreamServer::isActive() const
+{
+    return listenFd_ >= 0;
+}
+
+int64 StreamServer::getDropped() const
+{
+    const ScopedLock sl(lock_);
+    return dropped_;
+}
+
+bool StreamServer::start(const String& target, Format format, SlowClientPolicy policy, String& error)
+{
+#if JUCE_LINUX
+    stop();
+    
+    format_ = format;
+    policy_ = policy;
+    
+    // a number is a TCP port on the loopback interface, anything else the path of a Unix socket
+    if (target.containsOnly("0123456789"))
+    {
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16)target.getIntValue());
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        
+        listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int reuse = 1;
+        if (listenFd_ < 0 ||
+            setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+            bind(listenFd_, (const sockaddr*)&address, sizeof(address)) != 0)
+        {
+            error = "Couldn't listen on TCP port " + target;
+            stop();
+            return false;
+        }
+        description_ = "TCP port " + target;
+    }
+    else
+    {
+        const String path = File::getCurrentWorkingDirectory().getChildFile(target).getFullPathName();
+        
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if ((size_t)path.getNumBytesAsUTF8() >= sizeof(address.sun_path))
+        {
+            error = "Unix socket path \"" + path + "\" is too long";
+            return false;
+        }
+        path.copyToUTF8(address.sun_path, sizeof(address.sun_path));
+        
+        // a socket that's left behind by an earlier run is replaced, but not any other file
+        struct stat info;
+        if (lstat(address.sun_path, &info) == 0)
+        {
+            if (!S_ISSOCK(info.st_mode))
+            {
+                error = "Couldn't create Unix socket \"" + path + "\", a file already exists";
+                return false;
+            }
+            unlink(address.sun_path);
+        }
+        
+        listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd_ < 0 || bind(listenFd_, (const sockaddr*)&address, sizeof(address)) != 0)
+        {
+            error = "Couldn't create Unix socket \"" + path + "\"";
+            stop();
+            return false;
+        }
+        unixPath_ = path;
+        description_ = "Unix socket " + path;
+    }
+    
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
+    epoll_event listenEvent {};
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.ptr = &listenFd_;
+    epoll_event wakeEvent {};
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.ptr = &wakeFd_;
+    
+    if (listen(listenFd_, 16) != 0 || epollFd_ < 0 || wakeFd_ < 0 ||
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, listenFd_, &listenEvent) != 0 ||
+        epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeFd_, &wakeEvent) != 0)
+    {
+        error = "Couldn't listen on " + description_;
+        stop();
+        return false;
+    }
+    
+    // message timestamps are based on the high resolution counter, they're written as
+    // milliseconds since the epoch
+    timeOffset_ = (double)Time::currentTimeMillis() - Time::getMillisecondCounterHiRes();
+    
+    std::cerr << "Serving MIDI messages on " << description_ << std::endl;
+    startThread();
+    
+    return true;
+#else
+    ignoreUnused(target, format, policy);
+    error = "Serving MIDI messages to clients is only supported on Linux";
+    return false;
+#endif
+}
+
+void StreamServer::stop()
+{
+#if JUCE_LINUX
+    if (isThreadRunning())
+    {
+        signalThreadShouldExit();
+        wakeUp();
+        stopThread(1000);
+    }
+    
+    {
+        const ScopedLock sl(lock_);
+        for (auto* client : clients_)
+        {
+            if (client->dropped_ > 0)
+            {
+                std::cerr << "Client " << client->number_ << " missed " << client->dropped_ << " messages" << std::endl;
+            }
+            close(client->fd_);
+        }
+        clients_.clear();
+    }
+    
+    for (int* fd : { &listenFd_, &epollFd_, &wakeFd_ })
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    
+    if (unixPath_.isNotEmpty())
+    {
+        unlink(unixPath_.toRawUTF8());
+        unixPath_.clear();
+    }
+#endif
+}
+
+void StreamServer::add(const uint8* data, int size, double timestamp)
+{
+    const char* bytes = (const char*)data;
+    size_t length = (size_t)size;
+    
+    if (format_ == TEXT)
+    {
+        // milliseconds since the epoch followed by the message bytes in hexadecimal
+        const size_t capacity = (size_t)size * 3 + 32;
+        if (capacity > lineCapacity_)
+        {
+            lineCapacity_ = capacity;
+            line_.realloc(lineCapacity_);
+        }
+        
+        static const char* const HEX = "0123456789ABCDEF";
+        char* line = line_.get();
+        length = (size_t)snprintf(line, 32, "%.3f", timestamp * 1000.0 + timeOffset_);
+        for (int i = 0; i < size; ++i)
+        {
+            line[length++] = ' ';
+            line[length++] = HEX[data[i] >> 4];
+            line[length++] = HEX[data[i] & 0xf];
+        }
+        line[length++] = '\n';
+        bytes = line;
+    }
+    
+    bool added = false;
+    {
+        const ScopedLock sl(lock_);
+        for (auto* client : clients_)
+        {
+            if (client->failed_)
+            {
+                continue;
+            }
+            
+            if (client->pending_.size() + length > CLIENT_BUFFER)
+            {
+                if (policy_ == DISCONNECT)
+                {
+                    client->failed_ = true;
+                    added = true;
+                }
+                else
+                {
+                    client->dropped_ += 1;
+                    dropped_ += 1;
+                }
+                continue;
+            }
+            
+            client->pending_.insert(client->pending_.end(), bytes, bytes + length);
+            added = true;
+        }
+    }
+    
+    // the writer thread is only woken up when it's waiting, it otherwise picks up the data itself
+    if (added && sleeping_.exchange(false))
+    {
+        wakeUp();
+    }
+}
+
+void StreamServer::wakeUp()
+{
+#if JUCE_LINUX
+    const uint64 value = 1;
+    ignoreUnused(write(wakeFd_, &value, sizeof(value)));
+#endif
+}
+
+void StreamServer::run()
+{
+#if JUCE_LINUX
+    epoll_event events[32];
+    
+    while (!threadShouldExit())
+    {
+        // announce the wait before looking for data, so that new data is never missed
+        sleeping_ = true;
+        bool pending = false;
+        {
+            const ScopedLock sl(lock_);
+            for (auto* client : clients_)
+            {
+                pending = pending || client->failed_ ||
+                          (client->writable_ && (!client->pending_.empty() || client->sent_ < client->sending_.size()));
+            }
+        }
+        
+        const int count = epoll_wait(epollFd_, events, numElementsInArray(events), pending ? 0 : 100);
+        sleeping_ = false;
+        
+        for (int i = 0; i < count; ++i)
+        {
+            void* ptr = events[i].data.ptr;
+            if (ptr == &listenFd_)
+            {
+                acceptClients();
+            }
+            else if (ptr == &wakeFd_)
+            {
+                uint64 value;
+                ignoreUnused(read(wakeFd_, &value, sizeof(value)));
+            }
+            else
+            {
+                auto* client = (Client*)ptr;
+                bool closed = (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0;
+                
+                // anything that clients send is ignored
+                if (!closed && (events[i].events & EPOLLIN))
+                {
+                    char ignored[256];
+                    ssize_t received;
+                    while ((received = recv(client->fd_, ignored, sizeof(ignored), 0)) > 0)
+                    {
+                    }
+                    closed = (received == 0);
+                }
+                
+                if (closed)
+                {
+                    removeClient(client, "disconnected");
+                    continue;
+                }
+                
+                if (events[i].events & EPOLLOUT)
+                {
+                    client->writable_ = true;
+                }
+            }
+        }
+        
+        for (int i = clients_.size(); --i >= 0;)
+        {
+            auto* client = clients_.getUnchecked(i);
+            if (client->failed_)
+            {
+                removeClient(client, "was disconnected for falling behind");
+            }
+            else if (client->writable_ && !flushClient(*client))
+            {
+                removeClient(client, "disconnected");
+            }
+        }
+    }
+#endif
+}
+
+void StreamServer::acceptClients()
+{
+#if JUCE_LINUX
+    for (;;)
+    {
+        const int fd = accept4(listenFd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        
+        if (unixPath_.isEmpty())
+        {
+            const int noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+        
+        auto client = std::make_unique<Client>();
+        client->fd_ = fd;
+        client->number_ = ++clientCount_;
+        
+        // edge triggered, so that writable sockets are only reported after they were full
+        epoll_event event {};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = client.get();
+        if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        
+        std::cerr << "Client " << client->number_ << " connected to " << description_ << std::endl;
+        
+        const ScopedLock sl(lock_);
+        clients_.add(client.release());
+    }
+#endif
+}
+
+bool StreamServer::flushClient(Client& client)
+{
+#if JUCE_LINUX
+    for (;;)
+    {
+        // the data that the receiving thread added is taken over in one go
+        if (client.sent_ == client.sending_.size())
+        {
+            client.sending_.clear();
+            client.sent_ = 0;
+            
+            const ScopedLock sl(lock_);
+            if (client.pending_.empty())
+            {
+                return true;
+            }
+            std::swap(client.pending_, client.sending_);
+        }
+        
+        const ssize_t written = send(client.fd_, client.sending_.data() + client.sent_, client.sending_.size() - client.sent_, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                client.writable_ = false;
+                return true;
+            }
+            if (errno != EINTR)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            client.sent_ += (size_t)written;
+        }
+    }
+#else
+    ignoreUnused(client);
+    return false;
+#endif
+}
+
+void StreamServer::removeClient(Client* client, const char* reason)
+{
+#if JUCE_LINUX
+    close(client->fd_);
+    
+    const ScopedLock sl(lock_);
+    std::cerr << "Client " << client->number_ << " " << reason;
+    if (client->dropped_ > 0)
+    {
+        std::cerr << ", it missed " << client->dropped_ << " messages";
+    }
+    std::cerr << std::endl;
+    clients_.removeObject(client);
+#else
+    ignoreUnused(client, reason);
+#endif
+}
@@ -0,0 +1,100 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Streams the received MIDI messages to every client that connects to a Unix domain socket or
+ * to a TCP port on localhost, either as raw MIDI bytes or as lines of text.
+ *
+ * The receiving thread only appends to a bounded buffer per client. A writer thread waits on
+ * epoll for new clients and for sockets that can be written to, so a slow client can't hold
+ * up the input. When the buffer of a client is full, it's either disconnected or misses the
+ * messages until it catches up.
+ */
+class StreamServer : public Thread
+{
+public:
+    enum Format
+    {
+        RAW,
+        TEXT
+    };
+
+    enum SlowClientPolicy
+    {
+        DISCONNECT,
+        DROP
+    };
+
+    static bool parseFormat(const String& name, Format& format);
+    static bool parsePolicy(const String& name, SlowClientPolicy& policy);
+
+    StreamServer();
+    ~StreamServer() override;
+
+    bool start(const String& target, Format format, SlowClientPolicy policy, String& error);
+    void stop();
+    bool isActive() const;
+
+    void add(const uint8* data, int size, double timestamp);
+    int64 getDropped() const;
+
+private:
+    static constexpr size_t CLIENT_BUFFER = 256 * 1024;
+
+    struct Client
+    {
+        int fd_                 { -1 };
+        int number_             { 0 };
+        std::vector<char> pending_;
+        std::vector<char> sending_;
+        size_t sent_            { 0 };
+        bool writable_          { true };
+        std::atomic<bool> failed_ { false };
+        int64 dropped_          { 0 };
+    };
+
+    void run() override;
+    void acceptClients();
+    bool flushClient(Client& client);
+    void removeClient(Client* client, const char* reason);
+    void wakeUp();
+
+    Format format_          { RAW };
+    SlowClientPolicy policy_{ DISCONNECT };
+    String description_;
+    String unixPath_;
+    int listenFd_           { -1 };
+    int epollFd_            { -1 };
+    int wakeFd_             { -1 };
+    std::atomic<bool> sleeping_ { false };
+
+    CriticalSection lock_;
+    OwnedArray<Client> clients_;
+    int clientCount_        { 0 };
+    int64 dropped_          { 0 };
+
+    HeapBlock<char> line_;
+    size_t lineCapacity_    { 0 };
+    double timeOffset_      { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StreamServer)
+};
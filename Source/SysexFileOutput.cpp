@@ -0,0 +1,358 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SysexFileOutput.h"
+
+#if (JUCE_LINUX || JUCE_MAC)
+#include <sys/resource.h>
+#endif
+
+SysexFileOutput::SysexFileOutput() : Thread("SysEx File Output")
+{
+}
+
+SysexFileOutput::~SysexFileOutput()
+{
+    close();
+}
+
+bool SysexFileOutput::open(const File& file)
+{
+    close();
+
+    file_ = file;
+    numbered_ = splitMessages_ || rotateSize_ > 0 || rotateTime_ > 0;
+    segment_ = 0;
+    pending_ = 0;
+    messageSize_ = 0;
+    messages_ = 0;
+    bytes_ = 0;
+    files_ = 0;
+    
+    // the first file is created right away to report problems with the path immediately,
+    // the writer thread takes care of creating all the files after that
+    if (!openSegment())
+    {
+        return false;
+    }
+    
+    startThread();
+    return true;
+}
+
+void SysexFileOutput::close()
+{
+    if (!isThreadRunning())
+    {
+        return;
+    }
+    
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+    
+    // whatever is still queued is written out, a message that was never completed is discarded
+    writeQueued();
+    closeSegment();
+    
+    String report;
+    report << "Stored " << messages_ << " SysEx message" << (messages_ == 1 ? "" : "s") << ", " << bytes_ << " bytes";
+    
+    if (numbered_)
+    {
+        report << " into " << files_ << " file" << (files_ == 1 ? "" : "s");
+    }
+    
+    const double seconds = lastWrite_ - firstWrite_;
+    if (bytes_ > 0 && seconds > 0.0)
+    {
+        report << " in " << String(seconds, 3) << " s (" << String(bytes_ / seconds / 1024.0, 1) << " KB/s)";
+    }
+    
+    const int64 peak = getPeakResidentSize();
+    if (peak > 0)
+    {
+        report << ", peak memory " << String(peak / (1024.0 * 1024.0), 1) << " MB";
+    }
+    
+    std::cerr << report << std::endl;
+}
+
+void SysexFileOutput::writePartial(const uint8* data, int size)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+    
+    // the received data always starts at the beginning of the message, only the new part is queued
+    if (size < pending_)
+    {
+        discardPartial();
+    }
+    
+    if (size > pending_)
+    {
+        queue(DATA, data + pending_, size - pending_);
+        pending_ = size;
+    }
+}
+
+void SysexFileOutput::writeComplete(const uint8* data, int size)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+    
+    writePartial(data, size);
+    queue(COMPLETE, nullptr, 0);
+    pending_ = 0;
+}
+
+void SysexFileOutput::discardPartial()
+{
+    if (pending_ == 0)
+    {
+        return;
+    }
+    
+    queue(DISCARD, nullptr, 0);
+    pending_ = 0;
+}
+
+void SysexFileOutput::queue(EventType type, const uint8* data, int size)
+{
+    while (isThreadRunning())
+    {
+        {
+            const ScopedLock sl(lock_);
+            
+            // when the writer falls behind, the receiving thread waits for it to catch up
+            if (queuedSize_ == 0 || queuedSize_ + (size_t)size <= MAX_QUEUED)
+            {
+                if (size > 0)
+                {
+                    const size_t needed = queuedSize_ + (size_t)size;
+                    if (queuedData_.getSize() < needed)
+                    {
+                        queuedData_.setSize(jmax(needed, queuedData_.getSize() * 2));
+                    }
+                    queuedData_.copyFrom(data, (int)queuedSize_, (size_t)size);
+                    queuedSize_ = needed;
+                }
+                queuedEvents_.add({ type, size });
+                break;
+            }
+        }
+        
+        notify();
+        dequeued_.wait(10);
+    }
+    
+    notify();
+}
+
+void SysexFileOutput::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(100);
+        writeQueued();
+        
+        // rotating by time never splits up a message
+        const int rotateTime = rotateTime_;
+        if (output_ != nullptr && rotateTime > 0 && messageSize_ == 0 && output_->getPosition() > 0 &&
+            Time::getMillisecondCounter() - segmentOpened_ >= (uint32)rotateTime * 1000)
+        {
+            closeSegment();
+        }
+    }
+}
+
+void SysexFileOutput::writeQueued()
+{
+    {
+        const ScopedLock sl(lock_);
+        writingData_.swapWith(queuedData_);
+        writingEvents_.swapWith(queuedEvents_);
+        queuedEvents_.clearQuick();
+        queuedSize_ = 0;
+    }
+    dequeued_.signal();
+    
+    const uint8* data = (const uint8*)writingData_.getData();
+    for (auto& event : writingEvents_)
+    {
+        switch (event.type_)
+        {
+            case DATA:
+            {
+                if (output_ == nullptr && !openSegment())
+                {
+                    std::cerr << "Couldn't create file \"" << segmentFile_.getFullPathName() << "\"" << std::endl;
+                }
+                
+                if (output_ != nullptr)
+                {
+                    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+                    if (bytes_ == 0)
+                    {
+                        firstWrite_ = now;
+                    }
+                    lastWrite_ = now;
+                    
+                    if (output_->getPosition() == 0)
+                    {
+                        segmentOpened_ = Time::getMillisecondCounter();
+                    }
+                    
+                    output_->write(data, (size_t)event.size_);
+                    messageSize_ += event.size_;
+                    bytes_ += event.size_;
+                }
+                data += event.size_;
+                break;
+            }
+            case COMPLETE:
+            {
+                if (output_ != nullptr && messageSize_ > 0)
+                {
+                    messages_ += 1;
+                    messageSize_ = 0;
+                    messageStart_ = output_->getPosition();
+                    
+                    const int64 rotateSize = rotateSize_;
+                    if (splitMessages_ || (rotateSize > 0 && messageStart_ >= rotateSize))
+                    {
+                        closeSegment();
+                    }
+                }
+                break;
+            }
+            case DISCARD:
+            {
+                if (output_ != nullptr && messageSize_ > 0)
+                {
+                    bytes_ -= messageSize_;
+                    messageSize_ = 0;
+                    output_->setPosition(messageStart_);
+                }
+                break;
+            }
+        }
+    }
+    writingEvents_.clearQuick();
+}
+
+bool SysexFileOutput::openSegment()
+{
+    segment_ += 1;
+    segmentFile_ = getSegmentFile(segment_);
+    segmentFile_.deleteFile();
+    if (compress_)
+    {
+        File(segmentFile_.getFullPathName() + ".gz").deleteFile();
+    }
+    
+    output_ = segmentFile_.createOutputStream(BUFFER_SIZE);
+    segmentOpened_ = Time::getMillisecondCounter();
+    messageStart_ = 0;
+    messageSize_ = 0;
+    
+    return output_ != nullptr;
+}
+
+void SysexFileOutput::closeSegment()
+{
+    if (output_ == nullptr)
+    {
+        return;
+    }
+    
+    if (messageSize_ > 0)
+    {
+        bytes_ -= messageSize_;
+        messageSize_ = 0;
+        output_->setPosition(messageStart_);
+    }
+    
+    output_->flush();
+    output_->truncate();
+    const bool empty = output_->getPosition() == 0;
+    output_.reset();
+    
+    // numbered files are only kept when they actually contain messages
+    if (empty && numbered_)
+    {
+        segmentFile_.deleteFile();
+        return;
+    }
+    
+    files_ += 1;
+    
+    if (compress_)
+    {
+        compressFile(segmentFile_);
+    }
+}
+
+void SysexFileOutput::compressFile(const File& file)
+{
+    File compressed(file.getFullPathName() + ".gz");
+    {
+        FileInputStream input(file);
+        std::unique_ptr<FileOutputStream> output = compressed.createOutputStream();
+        if (input.failedToOpen() || output == nullptr)
+        {
+            std::cerr << "Couldn't compress file \"" << file.getFullPathName() << "\"" << std::endl;
+            return;
+        }
+        
+        GZIPCompressorOutputStream gzip(*output, 9, GZIPCompressorOutputStream::windowBitsGZIP);
+        gzip.writeFromInputStream(input, -1);
+        gzip.flush();
+    }
+    file.deleteFile();
+}
+
+File SysexFileOutput::getSegmentFile(int number) const
+{
+    if (!numbered_)
+    {
+        return file_;
+    }
+    
+    return file_.getSiblingFile(file_.getFileNameWithoutExtension() + String::formatted("-%04d", number) + file_.getFileExtension());
+}
+
+int64 SysexFileOutput::getPeakResidentSize()
+{
+#if (JUCE_LINUX || JUCE_MAC)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if JUCE_MAC
+        return (int64)usage.ru_maxrss;
+#else
+        return (int64)usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Streams received SysEx messages into .syx files.
+ *
+ * The receiving thread only queues the SysEx data as it arrives. A writer thread then writes it
+ * out with a large write buffer, without flushing after each message. This thread also creates
+ * the files when each message gets its own numbered file or when files are rotated by size or
+ * time, and it gzip-compresses the files that were closed. When the output is closed, the
+ * throughput and the peak memory usage of the process are reported on standard error.
+ */
+class SysexFileOutput : public Thread
+{
+public:
+    SysexFileOutput();
+    ~SysexFileOutput() override;
+
+    void setSplitMessages(bool split) { splitMessages_ = split; }
+    void setRotateSize(int64 bytes) { rotateSize_ = bytes; }
+    void setRotateTime(int seconds) { rotateTime_ = seconds; }
+    void setCompress(bool compress) { compress_ = compress; }
+
+    bool open(const File& file);
+    void close();
+    bool isOpen() const { return isThreadRunning(); }
+
+    // data contains all the bytes of the current message that were received so far
+    void writePartial(const uint8* data, int size);
+    void writeComplete(const uint8* data, int size);
+    void discardPartial();
+
+    bool hasPartial() const { return pending_ > 0; }
+
+private:
+    enum EventType
+    {
+        DATA,
+        COMPLETE,
+        DISCARD
+    };
+
+    struct Event
+    {
+        EventType type_;
+        int size_;
+    };
+
+    void run() override;
+
+    void queue(EventType type, const uint8* data, int size);
+    void writeQueued();
+    bool openSegment();
+    void closeSegment();
+    void compressFile(const File& file);
+    File getSegmentFile(int number) const;
+    static int64 getPeakResidentSize();
+
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+    static constexpr size_t MAX_QUEUED = 16 << 20;
+
+    std::atomic<bool> splitMessages_    { false };
+    std::atomic<int64> rotateSize_      { 0 };
+    std::atomic<int> rotateTime_        { 0 };
+    std::atomic<bool> compress_         { false };
+
+    // receiving thread
+    int pending_                        { 0 };
+
+    CriticalSection lock_;
+    MemoryBlock queuedData_;
+    size_t queuedSize_                  { 0 };
+    Array<Event> queuedEvents_;
+    WaitableEvent dequeued_;
+
+    // writer thread
+    MemoryBlock writingData_;
+    Array<Event> writingEvents_;
+    File file_;
+    bool numbered_                      { false };
+    int segment_                        { 0 };
+    std::unique_ptr<FileOutputStream> output_;
+    File segmentFile_;
+    uint32 segmentOpened_               { 0 };
+    int64 messageStart_                 { 0 };
+    int64 messageSize_                  { 0 };
+    int64 messages_                     { 0 };
+    int64 bytes_                        { 0 };
+    int files_                          { 0 };
+    double firstWrite_                  { 0.0 };
+    double lastWrite_                   { 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SysexFileOutput)
+};
@@ -0,0 +1,180 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SysexMatcher.h"
+
+SysexMatcher::Node::Node()
+{
+    for (auto& child : children_)
+    {
+        child = -1;
+    }
+}
+
+bool SysexMatcher::compile(const String& patterns, String& error)
+{
+    trie_.clear();
+    trie_.emplace_back();
+    
+    StringArray items;
+    items.addTokens(patterns, ",", "\"");
+    for (auto& item : items)
+    {
+        if (!addPattern(item, error))
+        {
+            return false;
+        }
+    }
+    
+    return buildAutomaton(error);
+}
+
+bool SysexMatcher::addPattern(const String& pattern, String& error)
+{
+    String digits = pattern.removeCharacters(" \t").toUpperCase();
+    if (digits.isEmpty() || digits.length() % 2 != 0)
+    {
+        error = "SysEx pattern \"" + pattern.trim() + "\" needs pairs of hex digits";
+        return false;
+    }
+    
+    int node = 0;
+    for (int i = 0; i < digits.length(); i += 2)
+    {
+        String pair = digits.substring(i, i + 2);
+        int symbol;
+        if (pair == "??" || pair == "XX")
+        {
+            symbol = ANY;
+        }
+        else if (pair.containsOnly("0123456789ABCDEF"))
+        {
+            symbol = pair.getHexValue32();
+        }
+        else
+        {
+            error = "SysEx pattern \"" + pattern.trim() + "\" contains \"" + pair + "\", which isn't a hex byte or ??";
+            return false;
+        }
+        
+        if (trie_[(size_t)node].children_[symbol] < 0)
+        {
+            trie_[(size_t)node].children_[symbol] = (int)trie_.size();
+            trie_.emplace_back();
+        }
+        node = trie_[(size_t)node].children_[symbol];
+    }
+    trie_[(size_t)node].terminal_ = true;
+    
+    return true;
+}
+
+bool SysexMatcher::buildAutomaton(String& error)
+{
+    // the bytes that appear in the patterns each get their own class, all the others share one
+    numClasses_ = 1;
+    int representatives[257];
+    representatives[0] = -1;
+    for (int b = 0; b < 256; ++b)
+    {
+        byteClasses_[b] = 0;
+    }
+    for (auto& node : trie_)
+    {
+        for (int b = 0; b < 256; ++b)
+        {
+            if (node.children_[b] >= 0 && byteClasses_[b] == 0)
+            {
+                byteClasses_[b] = (uint8)numClasses_;
+                representatives[numClasses_++] = b;
+            }
+        }
+    }
+    
+    // each state of the automaton is the set of trie nodes that are reached at the same time,
+    // the root is always part of it since a pattern can start at any position
+    std::vector<std::vector<int>> states;
+    std::map<std::vector<int>, int> stateIds;
+    states.push_back({ 0 });
+    stateIds[states[0]] = 0;
+    transitions_.clear();
+    accepting_.clear();
+    
+    for (size_t s = 0; s < states.size(); ++s)
+    {
+        const std::vector<int> current = states[s];
+        
+        bool accepting = false;
+        for (int n : current)
+        {
+            accepting |= trie_[(size_t)n].terminal_;
+        }
+        accepting_.push_back(accepting ? 1 : 0);
+        
+        for (int c = 0; c < numClasses_; ++c)
+        {
+            const int b = representatives[c];
+            std::vector<int> next { 0 };
+            for (int n : current)
+            {
+                const Node& node = trie_[(size_t)n];
+                if (b >= 0 && node.children_[b] >= 0)
+                {
+                    next.push_back(node.children_[b]);
+                }
+                if (node.children_[ANY] >= 0)
+                {
+                    next.push_back(node.children_[ANY]);
+                }
+            }
+            std::sort(next.begin(), next.end());
+            next.erase(std::unique(next.begin(), next.end()), next.end());
+            
+            auto found = stateIds.find(next);
+            if (found == stateIds.end())
+            {
+                if ((int)states.size() >= MAX_STATES)
+                {
+                    error = "The SysEx patterns need more than " + String(MAX_STATES) + " matching states";
+                    return false;
+                }
+                found = stateIds.emplace(next, (int)states.size()).first;
+                states.push_back(next);
+            }
+            transitions_.push_back((uint16)found->second);
+        }
+    }
+    
+    trie_.clear();
+    return true;
+}
+
+bool SysexMatcher::matches(const uint8* data, int size) const
+{
+    int state = 0;
+    for (int i = 0; i < size; ++i)
+    {
+        state = transitions_[(size_t)(state * numClasses_ + byteClasses_[data[i]])];
+        if (accepting_[(size_t)state])
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Matches SysEx messages against any number of hex byte patterns in a single pass.
+ *
+ * The patterns are put in a trie, with an extra edge for the ?? wildcard, which is then turned
+ * into a deterministic automaton over classes of bytes, the same way Aho-Corasick turns a trie
+ * into a matcher. Matching a message is one table lookup per byte of its raw data, which
+ * includes the F0 and F7 bytes, so a pattern that starts with F0 only matches at the start.
+ */
+class SysexMatcher
+{
+public:
+    static constexpr int MAX_STATES = 4096;
+
+    SysexMatcher() = default;
+
+    bool compile(const String& patterns, String& error);
+    bool matches(const uint8* data, int size) const;
+
+private:
+    // the wildcard is the 257th symbol of the trie
+    static constexpr int ANY = 256;
+
+    struct Node
+    {
+        Node();
+
+        int children_[ANY + 1];
+        bool terminal_      { false };
+    };
+
+    bool addPattern(const String& pattern, String& error);
+    bool buildAutomaton(String& error);
+
+    std::vector<Node> trie_;
+
+    uint8 byteClasses_[256];
+    int numClasses_                 { 1 };
+    std::vector<uint16> transitions_;
+    std::vector<uint8> accepting_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SysexMatcher)
+};
@@ -0,0 +1,316 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TerminalDashboard.h"
+
+// intensity of the controller values in the controller map, unused controllers are blank
+static const char CONTROLLER_LEVELS[] = ".:-=+*#%@";
+
+TerminalDashboard::TerminalDashboard(const ControllerState& controllers) : controllerState_(controllers)
+{
+}
+
+void TerminalDashboard::start(int framesPerSecond, bool noteNumbers, int octaveMiddleC)
+{
+    for (int ch = 0; ch < 16; ++ch)
+    {
+        messages_[ch] = 0;
+        noteOns_[ch] = 0;
+        pitchBend_[ch] = -1;
+        pressure_[ch] = -1;
+        lastMessages_[ch] = 0;
+        lastNoteOns_[ch] = 0;
+        messageRates_[ch] = 0.0;
+        noteRates_[ch] = 0.0;
+        for (int i = 0; i < 128; ++i)
+        {
+            held_[ch][i] = 0;
+        }
+    }
+    
+    noteNumbers_ = noteNumbers;
+    octaveMiddleC_ = octaveMiddleC;
+    lastRates_ = Time::getMillisecondCounterHiRes() * 0.001;
+    firstFrame_ = true;
+    active_ = true;
+    
+    startTimerHz(jlimit(1, 60, framesPerSecond));
+}
+
+void TerminalDashboard::stop()
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    active_ = false;
+    stopTimer();
+    
+    // leave the last frame on screen and continue below it
+    std::cout << "\x1b[" << (ROWS + 1) << ";1H" << std::flush;
+}
+
+void TerminalDashboard::setPort(const String& name)
+{
+    const ScopedLock sl(portLock_);
+    port_ = name;
+}
+
+void TerminalDashboard::add(const uint8* data, int size)
+{
+    if (!active_ || size <= 0)
+    {
+        return;
+    }
+    
+    total_.fetch_add(1, std::memory_order_relaxed);
+    
+    const uint8 status = data[0];
+    if (status >= 0xf0)
+    {
+        return;
+    }
+    
+    const int ch = status & 0xf;
+    messages_[ch].fetch_add(1, std::memory_order_relaxed);
+    lastChannel_.store(ch, std::memory_order_relaxed);
+    
+    const uint8 data1 = size > 1 ? data[1] & 0x7f : 0;
+    const uint8 data2 = size > 2 ? data[2] & 0x7f : 0;
+    switch (status & 0xf0)
+    {
+        case 0x80:
+            held_[ch][data1].store(0, std::memory_order_relaxed);
+            break;
+        case 0x90:
+            held_[ch][data1].store(data2, std::memory_order_relaxed);
+            if (data2 != 0)
+            {
+                noteOns_[ch].fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        case 0xd0:
+            pressure_[ch].store(data1, std::memory_order_relaxed);
+            break;
+        case 0xe0:
+            pitchBend_[ch].store((int16)(data2 << 7 | data1), std::memory_order_relaxed);
+            break;
+        default:
+            break;
+    }
+}
+
+void TerminalDashboard::addUniversalPacket(const uint32* words)
+{
+    if (!active_)
+    {
+        return;
+    }
+    
+    // MIDI 2.0 values are scaled down to the 7-bit and 14-bit resolutions of the dashboard
+    const uint32 word = words[0];
+    const uint32 value = words[1];
+    const int ch = (int)((word >> 16) & 0xf);
+    const uint8 index = (uint8)((word >> 8) & 0x7f);
+    
+    total_.fetch_add(1, std::memory_order_relaxed);
+    messages_[ch].fetch_add(1, std::memory_order_relaxed);
+    lastChannel_.store(ch, std::memory_order_relaxed);
+    
+    switch ((word >> 20) & 0xf)
+    {
+        case 0x8:
+            held_[ch][index].store(0, std::memory_order_relaxed);
+            break;
+        case 0x9:
+            held_[ch][index].store((uint8)jmax(1u, value >> 25), std::memory_order_relaxed);
+            noteOns_[ch].fetch_add(1, std::memory_order_relaxed);
+            break;
+        case 0xd:
+            pressure_[ch].store((int16)(value >> 25), std::memory_order_relaxed);
+            break;
+        case 0xe:
+            pitchBend_[ch].store((int16)(value >> 18), std::memory_order_relaxed);
+            break;
+        default:
+            break;
+    }
+}
+
+void TerminalDashboard::timerCallback()
+{
+    updateRates();
+    render();
+    writeChanges();
+}
+
+void TerminalDashboard::updateRates()
+{
+    // rates are measured over a second to keep them readable
+    const double now = Time::getMillisecondCounterHiRes() * 0.001;
+    const double seconds = now - lastRates_;
+    if (seconds < 1.0)
+    {
+        return;
+    }
+    lastRates_ = now;
+    
+    const uint32 total = total_.load(std::memory_order_relaxed);
+    totalRate_ = (total - lastTotal_) / seconds;
+    lastTotal_ = total;
+    
+    for (int ch = 0; ch < 16; ++ch)
+    {
+        const uint32 messages = messages_[ch].load(std::memory_order_relaxed);
+        const uint32 notes = noteOns_[ch].load(std::memory_order_relaxed);
+        messageRates_[ch] = (messages - lastMessages_[ch]) / seconds;
+        noteRates_[ch] = (notes - lastNoteOns_[ch]) / seconds;
+        lastMessages_[ch] = messages;
+        lastNoteOns_[ch] = notes;
+    }
+}
+
+void TerminalDashboard::render()
+{
+    memset(screen_, ' ', sizeof(screen_));
+    
+    String port;
+    {
+        const ScopedLock sl(portLock_);
+        port = port_;
+    }
+    
+    print(0, 0, "receivemidi  " + port);
+    const String totals = String(totalRate_, 1) + " msg/s   total " + String((int64)total_.load(std::memory_order_relaxed));
+    print(0, COLUMNS - totals.length(), totals);
+    
+    print(2, 0, " ch    msg/s  notes/s   pb   cp  held");
+    for (int ch = 0; ch < 16; ++ch)
+    {
+        const int row = 3 + ch;
+        String line;
+        line << String(ch + 1).paddedLeft(' ', 3)
+             << String(messageRates_[ch], 1).paddedLeft(' ', 9)
+             << String(noteRates_[ch], 1).paddedLeft(' ', 9);
+        
+        const int16 pb = pitchBend_[ch].load(std::memory_order_relaxed);
+        line << (pb < 0 ? String("-") : String(pb)).paddedLeft(' ', 6);
+        const int16 cp = pressure_[ch].load(std::memory_order_relaxed);
+        line << (cp < 0 ? String("-") : String(cp)).paddedLeft(' ', 5);
+        line << " ";
+        
+        for (int note = 0; note < 128 && line.length() < COLUMNS - 5; ++note)
+        {
+            if (held_[ch][note].load(std::memory_order_relaxed) != 0)
+            {
+                line << " " << formatNote(note);
+            }
+        }
+        print(row, 0, line);
+    }
+    
+    const int ch = lastChannel_.load(std::memory_order_relaxed);
+    const ControllerState::Port* values = controllerState_.findPort(port);
+    print(20, 0, "controllers channel " + String(ch + 1) + " (blank is unused, . to @ is 0 to 127)");
+    for (int half = 0; half < 2; ++half)
+    {
+        String line = String(half * 64).paddedLeft(' ', 3) + "  ";
+        for (int cc = half * 64; cc < half * 64 + 64; ++cc)
+        {
+            const int value = values != nullptr ? values->channels_[ch].get(cc) : -1;
+            line << (value < 0 ? ' ' : CONTROLLER_LEVELS[value * 9 / 128]);
+        }
+        print(21 + half, 0, line);
+    }
+}
+
+void TerminalDashboard::print(int row, int column, const String& text)
+{
+    for (int i = 0; i < text.length() && column + i < COLUMNS; ++i)
+    {
+        if (column + i < 0)
+        {
+            continue;
+        }
+        
+        const juce_wchar c = text[i];
+        screen_[row][column + i] = c >= 32 && c < 127 ? (char)c : '?';
+    }
+}
+
+void TerminalDashboard::writeChanges()
+{
+    std::string output;
+    if (firstFrame_)
+    {
+        output += "\x1b[2J";
+        memset(previous_, 0, sizeof(previous_));
+        firstFrame_ = false;
+    }
+    
+    for (int row = 0; row < ROWS; ++row)
+    {
+        int column = 0;
+        while (column < COLUMNS)
+        {
+            if (screen_[row][column] == previous_[row][column])
+            {
+                ++column;
+                continue;
+            }
+            
+            // nearby changes are written together, which is shorter than moving the cursor again
+            int end = column + 1;
+            int unchanged = 0;
+            for (int c = end; c < COLUMNS && unchanged < 8; ++c)
+            {
+                if (screen_[row][c] != previous_[row][c])
+                {
+                    end = c + 1;
+                    unchanged = 0;
+                }
+                else
+                {
+                    ++unchanged;
+                }
+            }
+            
+            output += "\x1b[" + std::to_string(row + 1) + ";" + std::to_string(column + 1) + "H";
+            output.append(&screen_[row][column], (size_t)(end - column));
+            column = end;
+        }
+    }
+    
+    if (!output.empty())
+    {
+        output += "\x1b[" + std::to_string(ROWS + 1) + ";1H";
+        std::cout << output << std::flush;
+        memcpy(previous_, screen_, sizeof(screen_));
+    }
+}
+
+String TerminalDashboard::formatNote(int note) const
+{
+    if (noteNumbers_)
+    {
+        return String(note);
+    }
+    
+    return MidiMessage::getMidiNoteName(note, true, true, octaveMiddleC_);
+}
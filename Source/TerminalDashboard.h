@@ -0,0 +1,87 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "ControllerState.h"
+
+/**
+ * Full-screen terminal view of the received MIDI traffic, similar to top.
+ *
+ * The receiving thread only updates relaxed atomic counters and values. The message thread
+ * renders a frame at a fixed rate into a character grid and writes only the cells that changed
+ * since the previous frame, so the terminal output is limited by the frame rate and not by the
+ * MIDI rate. The controller values are read from the shared controller state of the port.
+ */
+class TerminalDashboard : public Timer
+{
+public:
+    TerminalDashboard(const ControllerState& controllers);
+
+    void start(int framesPerSecond, bool noteNumbers, int octaveMiddleC);
+    void stop();
+    bool isActive() const { return active_; }
+
+    void setPort(const String& name);
+    void add(const uint8* data, int size);
+    void addUniversalPacket(const uint32* words);
+
+private:
+    static constexpr int ROWS = 24;
+    static constexpr int COLUMNS = 80;
+
+    void timerCallback() override;
+
+    void updateRates();
+    void render();
+    void print(int row, int column, const String& text);
+    void writeChanges();
+    String formatNote(int note) const;
+
+    const ControllerState& controllerState_;
+    std::atomic<bool> active_                   { false };
+
+    // updated by the receiving thread
+    std::atomic<uint32> total_                  { 0 };
+    std::atomic<uint32> messages_[16];
+    std::atomic<uint32> noteOns_[16];
+    std::atomic<uint8> held_[16][128];
+    std::atomic<int16> pitchBend_[16];
+    std::atomic<int16> pressure_[16];
+    std::atomic<int> lastChannel_               { 0 };
+
+    // only used by the message thread
+    CriticalSection portLock_;
+    String port_;
+    bool noteNumbers_                           { false };
+    int octaveMiddleC_                          { 3 };
+    double lastRates_                           { 0.0 };
+    uint32 lastTotal_                           { 0 };
+    uint32 lastMessages_[16];
+    uint32 lastNoteOns_[16];
+    double totalRate_                           { 0.0 };
+    double messageRates_[16];
+    double noteRates_[16];
+    char screen_[ROWS][COLUMNS];
+    char previous_[ROWS][COLUMNS];
+    bool firstFrame_                            { true };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TerminalDashboard)
+};
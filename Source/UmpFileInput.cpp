@@ -0,0 +1,116 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UmpFileInput.h"
+
+const String UmpFileInput::STANDARD_INPUT = "-";
+
+static const char CLIP_FILE_HEADER[] = "SMF2CLIP";
+
+UmpFileInput::UmpFileInput(ump::Receiver& receiver) : Thread("UMP Input"), receiver_(receiver)
+{
+}
+
+UmpFileInput::~UmpFileInput()
+{
+    // a thread that's blocked on standard input can't be interrupted, it's left to end with the process
+    signalThreadShouldExit();
+    stopThread(100);
+}
+
+bool UmpFileInput::start(const String& path)
+{
+    if (path != STANDARD_INPUT)
+    {
+        File file = File::getCurrentWorkingDirectory().getChildFile(path);
+        file_ = file.createInputStream();
+        if (file_ == nullptr)
+        {
+            return false;
+        }
+    }
+
+    startThread();
+    return true;
+}
+
+bool UmpFileInput::readWord(uint32& word)
+{
+    uint8 bytes[4];
+    if (file_ != nullptr)
+    {
+        if (file_->read(bytes, 4) != 4)
+        {
+            return false;
+        }
+    }
+    else if (!std::cin.read((char*)bytes, 4))
+    {
+        return false;
+    }
+    word = ByteOrder::bigEndianInt(bytes);
+    return true;
+}
+
+void UmpFileInput::run()
+{
+    uint32 words[4];
+    bool first = true;
+
+    while (!threadShouldExit() && readWord(words[0]))
+    {
+        uint32 num_read = 1;
+
+        // skip the header of a MIDI Clip File, when the second word doesn't match it already
+        // belongs to the first packet
+        if (first)
+        {
+            first = false;
+            if (words[0] == ByteOrder::bigEndianInt(CLIP_FILE_HEADER))
+            {
+                if (!readWord(words[1]))
+                {
+                    break;
+                }
+                if (words[1] == ByteOrder::bigEndianInt(CLIP_FILE_HEADER + 4))
+                {
+                    continue;
+                }
+                num_read = 2;
+            }
+        }
+
+        auto num_words = ump::Utils::getNumWordsForMessageType(words[0]);
+        bool complete = true;
+        for (uint32 i = num_read; i < num_words && complete; ++i)
+        {
+            complete = readWord(words[i]);
+        }
+        if (!complete)
+        {
+            break;
+        }
+
+        receiver_.packetReceived(ump::View(words), Time::getMillisecondCounterHiRes() * 0.001);
+    }
+
+    if (!threadShouldExit())
+    {
+        MessageManager::callAsync([] { JUCEApplicationBase::getInstance()->systemRequestedQuit(); });
+    }
+}
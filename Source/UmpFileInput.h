@@ -0,0 +1,50 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+#include "UniversalMidiPackets.h"
+
+/**
+ * Reads Universal MIDI Packets as a stream of big-endian 32-bit words from a file or from
+ * standard input, and hands each complete packet to the receiver on a background thread.
+ *
+ * A leading "SMF2CLIP" header of a MIDI Clip File is skipped, the application quits once
+ * the end of the stream has been reached.
+ */
+class UmpFileInput : public Thread
+{
+public:
+    UmpFileInput(ump::Receiver& receiver);
+    ~UmpFileInput() override;
+
+    bool start(const String& path);
+
+    static const String STANDARD_INPUT;
+
+private:
+    void run() override;
+    bool readWord(uint32& word);
+
+    ump::Receiver& receiver_;
+    std::unique_ptr<FileInputStream> file_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UmpFileInput)
+};
@@ -0,0 +1,51 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "UserSignal.h"
+
+#if (JUCE_LINUX || JUCE_MAC)
+#include <signal.h>
+#endif
+
+static std::atomic<uint32> signalCount { 0 };
+
+#if (JUCE_LINUX || JUCE_MAC)
+static void handleUserSignal(int)
+{
+    signalCount.fetch_add(1);
+}
+#endif
+
+void UserSignal::install()
+{
+#if (JUCE_LINUX || JUCE_MAC)
+    signal(SIGUSR1, handleUserSignal);
+#endif
+}
+
+bool UserSignal::receivedSince(uint32& seen)
+{
+    const uint32 count = signalCount.load();
+    if (count == seen)
+    {
+        return false;
+    }
+    
+    seen = count;
+    return true;
+}
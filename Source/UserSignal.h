@@ -0,0 +1,37 @@
+/*
+ * This file is part of ReceiveMIDI.
+ * Copyright (command) 2017-2024 Uwyn LLC.  https://www.uwyn.com
+ *
+ * ReceiveMIDI is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ReceiveMIDI is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "JuceHeader.h"
+
+/**
+ * Counts the SIGUSR1 signals (Linux/macOS), so that several parts can act on the same signal.
+ *
+ * The signal handler only increments a counter, each part remembers the count that it has
+ * seen and checks for newer signals from a timer.
+ */
+class UserSignal
+{
+public:
+    static void install();
+    static bool receivedSince(uint32& seen);
+
+private:
+    UserSignal() = delete;
+};